@@ -0,0 +1,479 @@
+/**
+ * @file    merkle_bench.cc
+ * @brief   Micro and macro benchmarks of the Merkle trees
+ * @author  https://github.com/gdaneek
+ * @date    16.10.2026
+ * @version 1.1
+ * @see https://github.com/gdaneek/merkle-tree
+ *
+ * Usage: merkle_bench [--min-log2 N] [--max-log2 N] [--proof-max-log2 N] [--leaf-size BYTES]
+ *                     [--min-time SECONDS] [--filter SUBSTRING] [--format json|csv] [--out FILE] [--perf]
+ */
+
+#include "merkle.hpp"
+#include "merkle_cache.hpp"
+#include "merkle_cdc.hpp"
+#include "merkle_fs.hpp"
+#include "merkle_numa.hpp"
+#include "merkle_soa.hpp"
+#include "merkle_uring.hpp"
+#include "perf_counters.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <concepts>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+
+using namespace merkle;
+
+namespace bench {
+
+    /**
+     * @brief prevents the compiler from optimizing away a calculated value
+     */
+    template<typename T>
+    inline void do_not_optimize(const T& v) {
+        asm volatile("" : : "r,m"(v) : "memory");
+    }
+
+
+    struct Options {
+        size_t min_log2{4}, max_log2{20}; ///< range of tree sizes for the build benchmarks (up to 2^24)
+        size_t proof_max_log2{16}; ///< the largest tree for proof / lookup benchmarks (they use linear search)
+        size_t leaf_size{64}; ///< bytes in one leaf
+        double min_time{0.1}; ///< minimal measurement time of one benchmark, seconds
+        std::string filter{}; ///< run only benchmarks whose name contains the substring
+        std::string format{"json"};
+        std::string out{};
+        bool perf{}; ///< read hardware performance counters around each benchmark
+    };
+
+
+    /**
+     * @brief one row of the report
+     */
+    struct Result {
+        std::string name;
+        std::string hasher;
+        size_t n; ///< number of leaves or input size in bytes, depending on the benchmark
+        size_t iters;
+        double ns_per_op;
+        double hashes_per_s;
+        double bytes_per_s;
+        double hashes; ///< hash calls per op
+        PerfCounters::Values counters; ///< hardware events per op, missing if unavailable
+    };
+
+
+    class Harness {
+        Options m_opts;
+        std::vector<Result> m_results{};
+        PerfCounters m_perf;
+
+
+        /**
+         * @brief prints a counter value or an empty / null field if it is missing
+         */
+        static void print_counter(std::ostream& os, const std::optional<double>& v, double div, const char* missing) {
+            if(v && div > 0)
+                os << *v / div;
+            else os << missing;
+        }
+
+    public:
+
+        explicit Harness(Options opts) : m_opts{std::move(opts)}, m_perf{m_opts.perf} {
+            if(m_opts.perf && !m_perf.available())
+                std::cerr << "perf events are unavailable, hardware counters will not be reported\n";
+        }
+
+        const Options& options() const {
+            return m_opts;
+        }
+
+
+        bool enabled(std::string_view name) const {
+            return name.find(m_opts.filter) != std::string_view::npos;
+        }
+
+
+        /**
+         * @brief runs `op` in growing batches until the minimal time is reached
+         * @param hashes number of hash calls performed by one `op`, or a function returning the number
+         * of hash calls made so far if it differs between the calls (e.g. misses of a cache)
+         * @param bytes number of input bytes processed by one `op`
+         */
+        template<typename Hashes>
+        void run(std::string name, std::string hasher, size_t n, Hashes&& hashes, size_t bytes, auto&& op) {
+            if(!enabled(name))
+                return;
+
+            using clock = std::chrono::steady_clock;
+            op();  // warm up
+
+            auto hashes_total = [&]() -> double {
+                if constexpr (std::invocable<Hashes>)
+                    return static_cast<double>(hashes());
+                else return 0;
+            };
+            const double hashes_before = hashes_total();
+
+            size_t iters{}, batch{1};
+            double elapsed{};
+            m_perf.start();
+            while(elapsed < m_opts.min_time) {
+                auto start = clock::now();
+                for(size_t i{};i < batch;++i)
+                    op();
+                elapsed += std::chrono::duration<double>(clock::now() - start).count();
+                iters += batch, batch <<= 1;
+            }
+
+            auto counters = m_perf.stop();
+            for(auto&& c : counters)
+                if(c) *c /= iters;
+
+            double per_op{};
+            if constexpr (std::invocable<Hashes>)
+                per_op = (hashes_total() - hashes_before) / iters;
+            else per_op = static_cast<double>(hashes);
+
+            m_results.push_back({std::move(name), std::move(hasher), n, iters, elapsed * 1e9 / iters,
+                                 per_op * iters / elapsed, bytes * iters / elapsed, per_op, counters});
+            std::cerr << m_results.back().name << " [" << m_results.back().hasher << ", n = " << n << "]: "
+                      << m_results.back().ns_per_op << " ns/op\n";
+        }
+
+
+        void report(std::ostream& os) const {
+            if(m_opts.format == "csv") {
+                os << "name,hasher,n,iters,ns_per_op,hashes_per_s,bytes_per_s,ipc";
+                for(auto name : PerfCounters::names)
+                    os << ',' << name << "_per_op," << name << "_per_hash";
+                os << '\n';
+
+                for(auto&& r : m_results) {
+                    os << r.name << ',' << r.hasher << ',' << r.n << ',' << r.iters << ','
+                       << r.ns_per_op << ',' << r.hashes_per_s << ',' << r.bytes_per_s << ',';
+                    print_counter(os, r.counters[1], r.counters[0].value_or(0), "");
+                    for(auto&& c : r.counters) {
+                        os << ',', print_counter(os, c, 1, "");
+                        os << ',', print_counter(os, c, r.hashes, "");
+                    }
+                    os << '\n';
+                }
+                return;
+            }
+
+            os << "[\n";
+            for(size_t i{};i < m_results.size();++i) {
+                auto&& r = m_results[i];
+                os << "  {\"name\": \"" << r.name << "\", \"hasher\": \"" << r.hasher << "\", \"n\": " << r.n
+                   << ", \"iters\": " << r.iters << ", \"ns_per_op\": " << r.ns_per_op
+                   << ", \"hashes_per_s\": " << r.hashes_per_s << ", \"bytes_per_s\": " << r.bytes_per_s;
+
+                if(m_perf.available()) {
+                    os << ", \"ipc\": ";
+                    print_counter(os, r.counters[1], r.counters[0].value_or(0), "null");
+                    for(size_t j{};j < PerfCounters::events_n;++j) {
+                        os << ", \"" << PerfCounters::names[j] << "_per_op\": ";
+                        print_counter(os, r.counters[j], 1, "null");
+                        os << ", \"" << PerfCounters::names[j] << "_per_hash\": ";
+                        print_counter(os, r.counters[j], r.hashes, "null");
+                    }
+                }
+                os << (i + 1 < m_results.size()? "},\n" : "}\n");
+            }
+            os << "]\n";
+        }
+    };
+
+
+    /**
+     * @brief deterministic leaves of the given size
+     */
+    auto make_leaves(size_t n, size_t leaf_size) {
+        std::vector<std::string> leaves(n, std::string(leaf_size, '\0'));
+        uint64_t x{0x9e3779b97f4a7c15};
+        for(auto&& leaf : leaves)
+            for(auto&& c : leaf)
+                c = static_cast<char>((x ^= x << 13, x ^= x >> 7, x ^= x << 17));
+
+        return leaves;
+    }
+
+
+    /**
+     * @brief number of hash calls made by FixedSizeTree::build
+     */
+    constexpr size_t build_hashes(size_t n) {
+        size_t hashes{n};
+        for(;n > 1;n = (n + 1) >> 1)
+            hashes += (n + 1) >> 1;
+
+        return hashes;
+    }
+
+
+    /**
+     * @param pool threads of the parallel build, created once so the rows do not measure starting them
+     * @param numa per-node pools of the NUMA build, shared by all rows for the same reason
+     */
+    template<typename Hasher, size_t LOG2>
+    void tree_benchmarks(Harness& h, std::string_view hasher_name, ThreadPool& pool, NumaPools& numa) {
+        constexpr size_t N = size_t{1} << LOG2;
+        auto&& opts = h.options();
+        if(LOG2 < opts.min_log2 || LOG2 > opts.max_log2)
+            return;
+
+        using Tree = FixedSizeTree<Hasher, N>;
+        auto tree = std::make_unique<Tree>();   // too big for the stack
+        auto leaves = make_leaves(N, opts.leaf_size);
+        const std::string hname{hasher_name};
+
+        h.run("build", hname, N, build_hashes(N), N * opts.leaf_size, [&] {
+            tree->build(leaves);
+            do_not_optimize(tree->root());
+        });
+
+        h.run("build_parallel", hname, N, build_hashes(N), N * opts.leaf_size, [&] {
+            build_parallel(*tree, leaves, pool);
+            do_not_optimize(tree->root());
+        });
+
+        {
+            // rebuild after a change of one leaf, the rest is found in the cache
+            using Cache = HashCache<typename Tree::hash_type>;
+            Cache cache(2 * N * (sizeof(typename Cache::Key) + sizeof(typename Tree::hash_type) + Cache::entry_overhead));
+            tree->build(leaves, cache);
+            size_t i{};
+            h.run("build_cached", hname, N, [&] { return cache.misses(); }, N * opts.leaf_size, [&] {
+                ++leaves[(i = (i + 0x9e3779b1) & (N - 1))][0];
+                tree->build(leaves, cache);
+                do_not_optimize(tree->root());
+            });
+        }
+
+        h.run("build_numa", hname, N, build_hashes(N), N * opts.leaf_size, [&] {
+            build_numa(*tree, leaves, numa);
+            do_not_optimize(tree->root());
+        });
+
+        if constexpr (std::same_as<Hasher, Sha256>) {
+            SoaTree<Hasher, N> soa{};
+            h.run("build_soa", hname, N, build_hashes(N), N * opts.leaf_size, [&] {
+                soa.build(leaves);
+                do_not_optimize(soa.root());
+            });
+        }
+
+        if(LOG2 > opts.proof_max_log2)
+            return;
+
+        tree->build(leaves);
+        size_t i{};
+        auto next = [&]() -> auto& { return leaves[(i = (i + 0x9e3779b1) & (N - 1))]; };
+
+        h.run("find_leaf", hname, N, 1, opts.leaf_size, [&] {
+            do_not_optimize(tree->verify(next()));
+        });
+
+        h.run("get_proof", hname, N, 1, opts.leaf_size, [&] {
+            do_not_optimize(tree->get_proof(next()));
+        });
+
+        auto proof = tree->get_proof(leaves[N / 3]).second;
+        h.run("verify_proof", hname, N, 1 + LOG2, opts.leaf_size, [&] {
+            do_not_optimize(tree->verify_proof(leaves[N / 3], proof));
+        });
+    }
+
+
+    template<typename Hasher>
+    void hasher_benchmarks(Harness& h, std::string_view hasher_name, ThreadPool& pool, NumaPools& numa) {
+        const std::string hname{hasher_name};
+        auto run_sizes = [&]<size_t... LOG2>(std::index_sequence<LOG2...>) {
+            (tree_benchmarks<Hasher, LOG2 + 4>(h, hasher_name, pool, numa), ...);
+        };
+        run_sizes(std::make_index_sequence<21>{});  // 2^4 .. 2^24
+
+        for(size_t size : {32, 64, 256, 1024, 4096, 65536}) {
+            std::vector<char> input(size, 'x');
+            h.run("hasher", hname, size, 1, size, [&] {
+                do_not_optimize(Hasher{}(input));
+            });
+        }
+    }
+
+
+    void concat_benchmarks(Harness& h) {
+        for(size_t size : {32, 64, 256, 1024, 4096, 65536}) {
+            std::string leaf(size, 'x');
+            h.run("concat_unified", "-", size, 0, size, [&] {
+                do_not_optimize(bconcat::UnifiedConcatenator::concat(0, leaf));
+            });
+            std::vector<uint8_t> raw(size, 0x5a);
+            h.run("concat_unified_u8", "-", size, 0, size, [&] {
+                do_not_optimize(bconcat::UnifiedConcatenator::concat(0, raw));
+            });
+            h.run("concat_scratch", "-", size, 0, size, [&] {
+                do_not_optimize(bconcat::ScratchConcatenator::concat(0, leaf));
+            });
+            h.run("concat_segment", "-", size, 0, size, [&] {
+                do_not_optimize(bconcat::SegmentConcatenator::concat(0, leaf));
+            });
+            std::vector<std::string> record(8, std::string(size / 8, 'x'));
+            h.run("concat_deep", "-", size, 0, size, [&] {
+                do_not_optimize(bconcat::DeepConcatenator::concat(0, record));
+            });
+            h.run("leaf_sha256_unified", "-", size, 0, size, [&] {
+                do_not_optimize(Sha256{}(bconcat::UnifiedConcatenator::concat(0, leaf)));
+            });
+            h.run("leaf_sha256_segment", "-", size, 0, size, [&] {
+                do_not_optimize(hash_segments(Sha256{}, bconcat::SegmentConcatenator::concat(0, leaf)));
+            });
+        }
+
+        std::array<char, 32> lhs{}, rhs{};
+        h.run("concat_trivial_node", "-", 2 * lhs.size(), 0, 2 * lhs.size(), [&] {
+            do_not_optimize(bconcat::TrivialConcatenator::concat(1, lhs, rhs));
+        });
+        h.run("concat_unified_node", "-", 2 * lhs.size(), 0, 2 * lhs.size(), [&] {
+            do_not_optimize(bconcat::UnifiedConcatenator::concat(1, lhs, rhs));
+        });
+    }
+
+
+    void chunking_benchmarks(Harness& h) {
+        const size_t size = size_t{1} << 24;
+        auto blob = make_leaves(1, size).front();
+
+        for(size_t avg : {4096, 8192, 65536}) {
+            FastCdc cdc({.min_size = avg / 4, .avg_size = avg, .max_size = avg * 8});
+            h.run("fastcdc_" + std::to_string(avg), "-", size, 0, size, [&] {
+                size_t chunks{};
+                cdc.split(blob, [&](auto) { ++chunks; });
+                do_not_optimize(chunks);
+            });
+        }
+    }
+
+
+    /**
+     * @brief file ingestion through mmap / read, the pread thread pool and io_uring on the same data
+     * @details Files are in the page cache after the warm-up, so the syscall and scheduling overhead is measured
+     */
+    void io_benchmarks(Harness& h) {
+        const std::array names{"files_mmap", "files_pread", "files_uring", "blob_read", "blob_pread", "blob_uring"};
+        if(std::none_of(names.begin(), names.end(), [&](auto name) { return h.enabled(name); }))
+            return;
+
+        namespace fs = std::filesystem;
+        auto dir = fs::temp_directory_path() / "merkle_bench_io";
+        fs::remove_all(dir);
+        fs::create_directories(dir / "files");
+
+        const size_t files_n = 2048, file_size = 16384, blob_size = size_t{1} << 28, chunk = size_t{1} << 20;
+        auto contents = make_leaves(files_n, file_size);
+        for(size_t i{};i < files_n;++i)
+            std::ofstream(dir / "files" / std::to_string(i), std::ios::binary) << contents[i];
+        {
+            std::ofstream blob(dir / "blob", std::ios::binary);
+            auto block = make_leaves(1, chunk).front();
+            for(size_t i{};i < blob_size / chunk;++i)
+                blob << block;
+        }
+
+        using Tree = AppendOnlyTree<Fnv1a>;
+        PreadReader::Options ropts{.buffers = 32, .buffer_size = chunk};
+        PreadReader pread_reader(ropts);
+        UringReader uring_reader(ropts);
+
+        auto files = [&](auto&&... reader) {
+            Tree tree{};
+            do_not_optimize(FileTreeBuilder(tree).build(dir / "files", reader...).files);
+        };
+        auto blob = [&](auto&&... reader) {
+            Tree tree{};
+            do_not_optimize(ChunkedBlobBuilder(tree, {.chunk_size = chunk}).build(dir / "blob", reader...));
+        };
+
+        h.run("files_mmap", "fnv1a", files_n, files_n, files_n * file_size, [&] { files(); });
+        h.run("files_pread", "fnv1a", files_n, files_n, files_n * file_size, [&] { files(pread_reader); });
+        h.run("blob_read", "fnv1a", blob_size, blob_size / chunk, blob_size, [&] { blob(); });
+        h.run("blob_pread", "fnv1a", blob_size, blob_size / chunk, blob_size, [&] { blob(pread_reader); });
+
+        if(uring_reader.valid()) {
+            h.run("files_uring", "fnv1a", files_n, files_n, files_n * file_size, [&] { files(uring_reader); });
+            h.run("blob_uring", "fnv1a", blob_size, blob_size / chunk, blob_size, [&] { blob(uring_reader); });
+        }
+        else std::cerr << "io_uring is unavailable, skipping its benchmarks\n";
+
+        fs::remove_all(dir);
+    }
+
+
+    Options parse(int argc, char** argv) {
+        Options opts{};
+        for(int i = 1;i < argc;++i) {
+            std::string_view key{argv[i]};
+            if(key == "--perf") {
+                opts.perf = true;
+                continue;
+            }
+
+            if(i + 1 == argc) {
+                std::cerr << "missing value of " << key << "\n";
+                break;
+            }
+
+            std::string_view val{argv[++i]};
+            if(key == "--min-log2") opts.min_log2 = std::strtoull(val.data(), nullptr, 10);
+            else if(key == "--max-log2") opts.max_log2 = std::strtoull(val.data(), nullptr, 10);
+            else if(key == "--proof-max-log2") opts.proof_max_log2 = std::strtoull(val.data(), nullptr, 10);
+            else if(key == "--leaf-size") opts.leaf_size = std::strtoull(val.data(), nullptr, 10);
+            else if(key == "--min-time") opts.min_time = std::strtod(val.data(), nullptr);
+            else if(key == "--filter") opts.filter = val;
+            else if(key == "--format") opts.format = val;
+            else if(key == "--out") opts.out = val;
+            else std::cerr << "unknown option " << key << "\n";
+        }
+
+        return opts;
+    }
+
+}
+
+
+int main(int argc, char** argv) {
+    bench::Harness h(bench::parse(argc, argv));
+    ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()) - 1);   // after the harness to inherit its counters
+    NumaPools numa{};
+
+    bench::hasher_benchmarks<Sha256>(h, "sha256", pool, numa);
+    bench::hasher_benchmarks<Truncated<Sha256, 16>>(h, "sha256_128", pool, numa);
+    bench::hasher_benchmarks<Fnv1a>(h, "fnv1a", pool, numa);
+    bench::concat_benchmarks(h);
+    bench::chunking_benchmarks(h);
+    bench::io_benchmarks(h);
+
+    if(h.options().out.empty())
+        h.report(std::cout);
+    else {
+        std::ofstream out(h.options().out);
+        h.report(out);
+    }
+
+    return 0;
+}
@@ -0,0 +1,149 @@
+/**
+ * @file    perf_counters.hpp
+ * @brief   Hardware performance counters for the benchmarks (Linux perf_event_open)
+ * @author  https://github.com/gdaneek
+ * @date    16.10.2026
+ * @version 1.1
+ * @see https://github.com/gdaneek/merkle-tree
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace bench {
+
+    /**
+     * @brief set of hardware counters read around a measured code section
+     * @details
+     * Every event is opened separately, so an event unsupported by the CPU (or hidden by a VM/container)
+     * does not disable the others. If perf events are not available at all (no permissions, seccomp,
+     * non-Linux system) all values are reported as missing and the benchmarks run as usual.
+     * Values are scaled by time_enabled / time_running when the kernel multiplexes the counters.
+     * Only user space is counted, which is allowed with the default perf_event_paranoid level.
+     * Events are inherited by the threads started after the counters are opened, so the worker pools
+     * of multithreaded benchmarks are counted as long as they are created after this object.
+     */
+    class PerfCounters {
+    public:
+        static constexpr size_t events_n = 6;
+        static constexpr std::array<const char*, events_n> names = {
+            "cycles", "instructions", "l1d_misses", "llc_misses", "dtlb_misses", "branch_misses"
+        };
+
+        using Values = std::array<std::optional<double>, events_n>;
+
+    private:
+        std::array<int, events_n> m_fds; ///< -1 for unavailable events
+
+#ifdef __linux__
+        static int open_event(uint32_t type, uint64_t config) {
+            perf_event_attr attr;
+            memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = type;
+            attr.config = config;
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.inherit = 1;
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+            return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+        }
+
+        static constexpr uint64_t cache_miss(uint64_t cache) {
+            return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        }
+#endif
+
+    public:
+
+        /**
+         * @param enabled if false, no events are opened
+         */
+        explicit PerfCounters(const bool enabled) {
+            m_fds.fill(-1);
+#ifdef __linux__
+            if(!enabled)
+                return;
+
+            m_fds = {open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES),
+                     open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS),
+                     open_event(PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_L1D)),
+                     open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES),
+                     open_event(PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_DTLB)),
+                     open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES)};
+#else
+            (void)enabled;
+#endif
+        }
+
+        PerfCounters(const PerfCounters&) = delete;
+        PerfCounters& operator=(const PerfCounters&) = delete;
+
+        ~PerfCounters() {
+#ifdef __linux__
+            for(auto fd : m_fds)
+                if(fd >= 0)
+                    close(fd);
+#endif
+        }
+
+
+        /**
+         * @brief whether at least one event is counted
+         */
+        bool available() const {
+            for(auto fd : m_fds)
+                if(fd >= 0)
+                    return true;
+
+            return false;
+        }
+
+
+        /**
+         * @brief resets and starts all available counters
+         */
+        void start() {
+#ifdef __linux__
+            for(auto fd : m_fds)
+                if(fd >= 0)
+                    ioctl(fd, PERF_EVENT_IOC_RESET, 0), ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+        }
+
+
+        /**
+         * @brief stops the counters
+         * @return counted values since the last `start`, missing for unavailable events
+         */
+        Values stop() {
+            Values values{};
+#ifdef __linux__
+            for(size_t i{};i < events_n;++i) {
+                if(m_fds[i] < 0)
+                    continue;
+
+                ioctl(m_fds[i], PERF_EVENT_IOC_DISABLE, 0);
+                uint64_t buf[3]{}; // value, time_enabled, time_running
+                if(read(m_fds[i], buf, sizeof(buf)) == sizeof(buf) && buf[2])
+                    values[i] = static_cast<double>(buf[0]) * buf[1] / buf[2];
+            }
+#endif
+            return values;
+        }
+    };
+
+}
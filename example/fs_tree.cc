@@ -1,31 +1,51 @@
-
 #include "merkle.hpp"
+#include "merkle_fs.hpp"
+#include "merkle_uring.hpp"
+#include <cstdlib>
+#include <iomanip>
 #include <string>
-#include <vector>
-
 
-struct Hasher {
-    using value_type = uint64_t;
-    constexpr auto operator()(auto&& cont) const -> value_type  {
-        uint64_t hash{};
-        for(auto&& x : cont)
-            hash = (hash * 31) + x;
-
-        return hash;
-    }
-};
 
 using namespace merkle;
 
-int main() {
-
-    std::vector<std::string> fnames = {"passwords.db", "users.txt", "raw_data.bin"};
+/*
+ * Usage: example [directory = .] [workers = number of cores] [reader = mmap|pread|uring]
+ * Hashes contents of all files of the directory and prints the root and the throughput
+ */
+int main(int argc, char** argv) {
+
+    std::filesystem::path dir = argc > 1? argv[1] : ".";
+
+    AppendOnlyTree<Sha256> tree;
+    FileTreeBuilder<decltype(tree)>::Options opts{};
+    if(argc > 2)
+        opts.workers = std::strtoull(argv[2], nullptr, 10);
+
+    std::string reader = argc > 3? argv[3] : "mmap";
+    PreadReader::Options ropts{};
+    FileTreeBuilder builder(tree, opts);
+    FileTreeBuilder<decltype(tree)>::Stats stats{};
+    if(reader == "uring") {
+        UringReader uring(ropts);
+        if(uring.valid())
+            stats = builder.build(dir, uring);
+        else std::cerr << "io_uring is unavailable, using pread\n", reader = "pread";
+    }
 
-    FixedSizeTree<Hasher, 3> tree; /* pass also fnames to immediate build*/
-    tree.build(fnames);
+    if(reader == "pread") {
+        PreadReader pread(ropts);
+        stats = builder.build(dir, pread);
+    }
+    else if(reader != "uring")
+        stats = builder.build(dir);
 
+    std::cout << "0x";
+    for(auto byte : tree.root())
+        std::cout << std::hex << std::setw(2) << std::setfill('0') << (int)byte;
 
-    std::cout << std::hex << "0x" << tree.root() << std::endl;
+    std::cout << std::dec << "\nfiles: " << stats.files << " (" << stats.errors << " unreadable)"
+              << ", bytes: " << stats.bytes << ", " << stats.seconds << " s, "
+              << stats.gbps() << " GB/s with " << opts.workers << " workers, " << reader << " reader" << std::endl;
 
     return 0;
 
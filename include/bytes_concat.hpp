@@ -15,9 +15,12 @@
 #include <algorithm>
 #include <cstring>
 #include <cstdint>
-
+#include <bit>
 
 #include <iterator>
+#include <ranges>
+#include <span>
+#include <tuple>
 #include <vector>
 #include <concepts>
 #include <type_traits>
@@ -27,23 +30,23 @@ namespace bconcat {
     /**
      * @brief performs concatenation of objects with a trivial copy constructor
      * @details
-     * - based on memcpy for performance
+     * - based on std::bit_cast (compiled to memcpy), so it is available in constant expressions
      * - return std::array of bytes
      * @note useful for POD types
      */
     class TrivialConcatenator {
     public:
 
-        static auto concat(auto&&... args) {
-            char bytes[(sizeof(args) + ...)];
+        static constexpr auto concat(auto&&... args) {
+            std::array<char, (sizeof(args) + ... + 0)> bytes{};
             uint64_t s{};
-            ((memcpy(bytes + s, &args, sizeof(args)), s += sizeof(args)), ...);
+            ((std::ranges::copy(std::bit_cast<std::array<char, sizeof(args)>>(args), bytes.begin() + s), s += sizeof(args)), ...);
 
-            return std::to_array(bytes);
+            return bytes;
         }
 
         template<typename... Args>
-        auto operator()(Args&&... args) const {
+        constexpr auto operator()(Args&&... args) const {
             return concat(std::forward<Args>(args)...);
         }
     };
@@ -72,23 +75,62 @@ namespace bconcat {
     /**
      * @brief concatenate any data structures
      * @details
-     * - based on std::copy
+     * - the size of all arguments is reserved up front, contiguous ranges of 1-byte elements are copied with memcpy,
+     * other iterables element by element
      * - works mainly with iterable structures,
      * otherwise it simply copies the bytes of the structure (necessary for correct processing of char, int, float, etc. types)
      * @note useful for STL-like containers
      */
     class UnifiedConcatenator {
+
+        template<typename T>
+        static constexpr bool byte_range = requires(T& t) {
+            requires std::ranges::contiguous_range<T> && std::ranges::sized_range<T>;
+            requires sizeof(*std::ranges::data(t)) == 1;
+        };
+
+
     public:
         using value_type = typename std::vector<char>;
 
+        /**
+         * @return number of bytes appended for the argument, 0 if it is unknown without iterating
+         */
+        template<typename T>
+        static constexpr size_t size_hint(const T& src) {
+            if constexpr (Iterable<const T&>) {
+                if constexpr (std::ranges::sized_range<const T&>)
+                    return std::ranges::size(src);
+                else return 0;
+            }
+            else return sizeof(T);
+        }
+
+
         template<typename T> requires Iterable<T>
-        static void append(value_type& dst, T&& src)  {
-            std::copy(std::begin(src), std::end(src), std::back_inserter(dst));
+        static constexpr void append(value_type& dst, T&& src)  {
+            if constexpr (byte_range<T>) {
+                if(!std::is_constant_evaluated()) {
+                    auto ptr = reinterpret_cast<const char*>(std::ranges::data(src));
+                    dst.insert(dst.end(), ptr, ptr + std::ranges::size(src));
+                    return;
+                }
+            }
+
+            dst.insert(dst.end(), std::begin(src), std::end(src));
         }
 
 
         template<typename T> requires (!Iterable<T> && MemcpyCopiable<T>)
-        static void append(value_type& dst, T&& src) {
+        static constexpr void append(value_type& dst, T&& src) {
+            if constexpr (std::is_trivially_copyable_v<std::remove_cvref_t<T>>) {
+                if(std::is_constant_evaluated()) {  // memcpy is not allowed in constant expressions
+                    auto bytes = std::bit_cast<std::array<char, sizeof(src)>>(src);
+                    dst.insert(dst.end(), bytes.begin(), bytes.end());
+                    return;
+                }
+            }
+
             auto curr_sz = dst.size();
             dst.resize(dst.size() + sizeof(src));
 
@@ -97,23 +139,404 @@ namespace bconcat {
 
 
         template<typename... Args>
-        static auto concat(Args&&... args) {
+        static constexpr auto concat(Args&&... args) {
             value_type bytes{};
+            bytes.reserve((size_hint(args) + ... + size_t{}));
             ((append(bytes, std::forward<Args>(args))), ...);
 
             return bytes;
         }
 
 
+        template<typename... Args>
+        constexpr auto operator()(Args&&... args) const {
+            return concat(std::forward<Args>(args)...);
+        }
+
+    };
+
+
+    /**
+     * @brief UnifiedConcatenator writing into a buffer reused by all calls on the thread
+     * @details
+     * Every call starts the per-thread buffer over and keeps its capacity, so once it has grown to the largest
+     * leaf, hashing does no allocations however many leaves (or threads, each with its own buffer) there are.
+     * The result is a view of the buffer with the same bytes as UnifiedConcatenator gives.
+     * @warning the view is valid until the next concatenation on the same thread, it must be hashed right away
+     * @note not available in constant expressions
+     */
+    class ScratchConcatenator {
+
+        static std::vector<char>& scratch() {
+            thread_local std::vector<char> buf{};
+            return buf;
+        }
+
+    public:
+        using value_type = std::span<const char>;
+
+        template<typename... Args>
+        static value_type concat(Args&&... args) {
+            auto& buf = scratch();
+            buf.clear();
+            buf.reserve((UnifiedConcatenator::size_hint(args) + ... + size_t{}));
+            ((UnifiedConcatenator::append(buf, std::forward<Args>(args))), ...);
+
+            return {buf.data(), buf.size()};
+        }
+
+
         template<typename... Args>
         auto operator()(Args&&... args) const {
             return concat(std::forward<Args>(args)...);
         }
 
+
+        /**
+         * @return bytes held by the buffer of the calling thread
+         */
+        static size_t capacity() {
+            return scratch().capacity();
+        }
+
+
+        /**
+         * @brief frees the buffer of the calling thread, e.g. after hashing unusually large leaves
+         */
+        static void release() {
+            std::vector<char>{}.swap(scratch());
+        }
+    };
+
+
+    /**
+    * @brief requires a list of byte segments, such as the result of SegmentConcatenator
+    */
+    template<typename T>
+    concept Segmented = requires(const T& t, size_t i) {
+        { t.segments() } -> std::convertible_to<size_t>;
+        { t.segment(i) } -> std::convertible_to<std::span<const char>>;
     };
 
 
-    // TODO: DeepConcatenator
+    /**
+     * @brief concatenation result that refers to the arguments instead of copying them (scatter-gather list)
+     * @details
+     * Contiguous ranges of 1-byte elements are referenced; scalars are copied into the inline storage
+     * (at most `LOCAL` bytes); other iterables are converted into a heap buffer as UnifiedConcatenator does.
+     * Iterating the list gives the same bytes as the UnifiedConcatenator result.
+     * @tparam N max number of segments
+     * @warning the referenced arguments must outlive the list, temporaries only live until the end of the full-expression
+     */
+    template<size_t N, size_t LOCAL>
+    class Segments {
+        enum class Kind : uint8_t { ref, local, heap };
+
+        struct Segment {
+            const char* ptr; ///< referenced bytes
+            size_t offset; ///< offset of stored bytes
+            size_t size;
+            Kind kind;
+        };
+
+        std::array<Segment, N> m_segs{};
+        size_t m_n{}, m_size{};
+        std::array<char, LOCAL> m_local{};
+        std::vector<char> m_heap{};
+        size_t m_local_used{};
+
+    public:
+
+        class iterator {
+            const Segments* m_list{};
+            size_t m_seg{}, m_off{};
+
+            void skip_empty() {
+                while(m_seg < m_list->m_n && m_off == m_list->m_segs[m_seg].size)
+                    ++m_seg, m_off = 0;
+            }
+
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = char;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const char*;
+            using reference = const char&;
+
+            iterator() = default;
+
+            iterator(const Segments* list, const size_t seg) : m_list{list}, m_seg{seg} {
+                skip_empty();
+            }
+
+            reference operator*() const {
+                return m_list->segment(m_seg)[m_off];
+            }
+
+            iterator& operator++() {
+                ++m_off, skip_empty();
+                return *this;
+            }
+
+            iterator operator++(int) {
+                auto it = *this;
+                ++*this;
+                return it;
+            }
+
+            bool operator==(const iterator& rhs) const {
+                return m_seg == rhs.m_seg && m_off == rhs.m_off;
+            }
+        };
+
+
+        void add(const char* ptr, const size_t n) {
+            m_segs[m_n++] = {ptr, 0, n, Kind::ref}, m_size += n;
+        }
+
+        void add_local(const void* ptr, const size_t n) {
+            memcpy(m_local.data() + m_local_used, ptr, n);
+            m_segs[m_n++] = {nullptr, m_local_used, n, Kind::local}, m_local_used += n, m_size += n;
+        }
+
+        template<typename T>
+        void add_converted(T&& src) {
+            const size_t offset = m_heap.size();
+            std::copy(std::begin(src), std::end(src), std::back_inserter(m_heap));
+            m_segs[m_n++] = {nullptr, offset, m_heap.size() - offset, Kind::heap}, m_size += m_heap.size() - offset;
+        }
+
+
+        /**
+         * @return number of segments
+         */
+        size_t segments() const {
+            return m_n;
+        }
+
+        std::span<const char> segment(const size_t i) const {
+            auto& s = m_segs[i];
+            const char* ptr = s.kind == Kind::ref? s.ptr : (s.kind == Kind::local? m_local.data() : m_heap.data()) + s.offset;
+            return {ptr, s.size};
+        }
+
+
+        /**
+         * @return total number of bytes
+         */
+        size_t size() const {
+            return m_size;
+        }
+
+        /**
+         * @return bytes allocated for converted arguments, 0 if nothing was copied to the heap
+         */
+        size_t capacity() const {
+            return m_heap.capacity();
+        }
+
+        iterator begin() const {
+            return {this, 0};
+        }
+
+        iterator end() const {
+            return {this, m_n};
+        }
+
+
+        /**
+         * @return all bytes in one buffer
+         */
+        std::vector<char> flatten() const {
+            std::vector<char> bytes{};
+            bytes.reserve(m_size);
+            for(size_t i{};i < m_n;++i)
+                bytes.insert(bytes.end(), segment(i).begin(), segment(i).end());
+
+            return bytes;
+        }
+    };
+
+
+    /**
+     * @brief concatenator producing a scatter-gather list of the arguments instead of a new buffer
+     * @details
+     * Large leaves are hashed straight from their storage: the hasher gets the segments one after another
+     * (see merkle::SegmentHasher), so nothing is copied. Hashers that just iterate over the input
+     * also work, they see the same bytes as with UnifiedConcatenator.
+     * @note not available in constant expressions
+     */
+    class SegmentConcatenator {
+
+        template<typename T>
+        static constexpr bool referenced = requires(T& t) {
+            requires std::ranges::contiguous_range<T>;
+            requires sizeof(*std::ranges::data(t)) == 1;
+        };
+
+        template<typename T>
+        static constexpr size_t local_size = Iterable<T>? 0 : sizeof(T);
+
+    public:
+
+        template<typename... Args>
+        static auto concat(Args&&... args) {
+            Segments<sizeof...(Args), (local_size<std::remove_cvref_t<Args>> + ... + 0)> list{};
+            ([&]<typename T>(T&& src) {
+                if constexpr (referenced<T>)
+                    list.add(reinterpret_cast<const char*>(std::ranges::data(src)), std::ranges::size(src));
+                else if constexpr (Iterable<T>)
+                    list.add_converted(src);
+                else list.add_local(&src, sizeof(src));
+            }(std::forward<Args>(args)), ...);
+
+            return list;
+        }
+
+
+        template<typename... Args>
+        auto operator()(Args&&... args) const {
+            return concat(std::forward<Args>(args)...);
+        }
+    };
+
+
+    /**
+    * @brief whether the concatenator encodes a byte range as the bytes themselves, without a length or other framing
+    * @details
+    * For such concatenators `concat(salt, bytes)` equals `concat(salt)` followed by `bytes`, so the salt can be written
+    * in front of the data by the caller. Specialize it for custom concatenators with this property
+    */
+    template<typename C>
+    inline constexpr bool plain_byte_ranges = std::same_as<C, UnifiedConcatenator> || std::same_as<C, ScratchConcatenator>
+                                              || std::same_as<C, SegmentConcatenator>;
+
+
+    /**
+    * @brief requires a tuple-like type (std::pair, std::tuple, ...)
+    */
+    template<typename T>
+    concept TupleLike = requires { std::tuple_size<std::remove_cvref_t<T>>::value; };
+
+
+    /**
+    * @brief requires a record exposing its fields as a tuple of references, e.g. `auto tie() const { return std::tie(id, tags); }`
+    */
+    template<typename T>
+    concept Tieable = requires(const T& t) {
+        { t.tie() } -> TupleLike;
+    };
+
+
+    /**
+     * @brief canonical serialization of nested containers, tuples and records
+     * @details
+     * - records with `tie()` and tuple-like values are encoded field by field
+     * - iterables are encoded as the number of elements (64-bit little-endian) followed by the elements,
+     * so `{"ab", "c"}` and `{"a", "bc"}` give different bytes
+     * - other values are copied as they are (like in UnifiedConcatenator)
+     *
+     * The size is calculated in a first pass, so the result is allocated once. Contiguous ranges of scalars
+     * are sized in O(1) and copied with one memcpy, only ranges of nested values are walked element by element.
+     * @note trivially copyable structs are copied with their padding, give them `tie()` to get canonical bytes
+     */
+    class DeepConcatenator {
+
+        template<typename T>
+        static constexpr bool scalar = !Tieable<T> && !Iterable<const T&> && !TupleLike<T>;
+
+        template<typename T>
+        using element_t = std::remove_cvref_t<decltype(*std::begin(std::declval<const T&>()))>;
+
+        static char* put_length(char* dst, uint64_t n) {
+            for(size_t i{};i < sizeof(n);++i, n >>= 8)
+                dst[i] = static_cast<char>(n & 0xff);
+
+            return dst + sizeof(n);
+        }
+
+    public:
+        using value_type = typename std::vector<char>;
+
+        /**
+         * @return number of bytes of the encoded value
+         */
+        template<typename T>
+        static size_t size(const T& v) {
+            if constexpr (Tieable<T>)
+                return size(v.tie());
+            else if constexpr (Iterable<const T&>) {
+                if constexpr (std::ranges::sized_range<const T&> && scalar<element_t<T>>)
+                    return sizeof(uint64_t) + std::ranges::size(v) * sizeof(element_t<T>);
+                else {
+                    size_t n{sizeof(uint64_t)};
+                    for(auto&& x : v)
+                        n += size(x);
+
+                    return n;
+                }
+            }
+            else if constexpr (TupleLike<T>)
+                return std::apply([](auto&... x) { return (size(x) + ... + size_t{}); }, v);
+            else {
+                static_assert(std::is_trivially_copyable_v<T>, "DeepConcatenator copies the bytes of non-container values");
+                return sizeof(T);
+            }
+        }
+
+
+        /**
+         * @brief writes the encoded value
+         * @return end of the written bytes
+         */
+        template<typename T>
+        static char* write(char* dst, const T& v) {
+            if constexpr (Tieable<T>)
+                return write(dst, v.tie());
+            else if constexpr (Iterable<const T&>) {
+                if constexpr (std::ranges::contiguous_range<const T&> && scalar<element_t<T>>) {
+                    const size_t n = std::ranges::size(v);
+                    dst = put_length(dst, n);
+                    if(n)
+                        memcpy(dst, std::ranges::data(v), n * sizeof(element_t<T>));
+
+                    return dst + n * sizeof(element_t<T>);
+                }
+                else {
+                    char* len = dst;
+                    uint64_t n{};
+                    dst += sizeof(uint64_t);
+                    for(auto&& x : v)
+                        dst = write(dst, x), ++n;
+                    put_length(len, n);
+
+                    return dst;
+                }
+            }
+            else if constexpr (TupleLike<T>)
+                return std::apply([&](auto&... x) { ((dst = write(dst, x)), ...); return dst; }, v);
+            else {
+                memcpy(dst, &v, sizeof(T));
+                return dst + sizeof(T);
+            }
+        }
+
+
+        template<typename... Args>
+        static value_type concat(const Args&... args) {
+            value_type bytes((size(args) + ... + size_t{}));
+            char* dst = bytes.data();
+            ((dst = write(dst, args)), ...);
+
+            return bytes;
+        }
+
+
+        template<typename... Args>
+        auto operator()(Args&&... args) const {
+            return concat(args...);
+        }
+    };
 }
 
 
@@ -0,0 +1,307 @@
+/**
+ *  @file    merkle_async.hpp
+ *  @brief   C++20 coroutine task type and the awaitable tree operations
+ *  @author  https://github.com/gdaneek
+ *  @date    16.10.2026
+ *  @version 1.1
+ *  @see https://github.com/gdaneek/merkle-tree
+ */
+
+#pragma once
+
+#include <concepts>
+#include <condition_variable>
+#include <coroutine>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <ranges>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "merkle_parallel.hpp"
+
+namespace merkle {
+
+    template<typename T = void>
+    class Task;
+
+
+    namespace detail {
+
+        /**
+         * @brief resumes the awaiting coroutine when a task is finished
+         */
+        struct FinalAwaiter {
+            bool await_ready() const noexcept {
+                return false;
+            }
+
+            template<typename Promise>
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> h) noexcept {
+                auto next = h.promise().continuation;
+                return next? next : std::noop_coroutine();
+            }
+
+            void await_resume() const noexcept {}
+        };
+
+
+        template<typename T>
+        struct PromiseBase {
+            std::coroutine_handle<> continuation{};
+            std::optional<T> value{};
+
+            void return_value(T v) {
+                value.emplace(std::move(v));
+            }
+
+            T result() {
+                return std::move(*value);
+            }
+        };
+
+        template<>
+        struct PromiseBase<void> {
+            std::coroutine_handle<> continuation{};
+
+            void return_void() const {}
+            void result() const {}
+        };
+
+
+        /**
+         * @brief eagerly started coroutine owning nothing, used to run a task to completion
+         */
+        struct Detached {
+            struct promise_type {
+                Detached get_return_object() const { return {}; }
+                std::suspend_never initial_suspend() const noexcept { return {}; }
+                std::suspend_never final_suspend() const noexcept { return {}; }
+                void return_void() const {}
+                void unhandled_exception() const { std::terminate(); }
+            };
+        };
+
+
+        template<typename T, typename F>
+        Detached run(Task<T> task, F on_done) {
+            if constexpr (std::is_void_v<T>)
+                co_await task, on_done();
+            else on_done(co_await task);
+        }
+    };
+
+
+    /**
+     * @brief lazy coroutine returning T, it starts when it is awaited (or passed to `start` / `sync_wait`)
+     * @details
+     * When the task finishes, the awaiting coroutine continues on the same thread without growing the stack.
+     * The library does not use exceptions: an exception escaping the coroutine terminates the program
+     */
+    template<typename T>
+    class Task {
+    public:
+
+        struct promise_type : detail::PromiseBase<T> {
+            Task get_return_object() {
+                return Task{std::coroutine_handle<promise_type>::from_promise(*this)};
+            }
+
+            std::suspend_always initial_suspend() const noexcept {
+                return {};
+            }
+
+            detail::FinalAwaiter final_suspend() const noexcept {
+                return {};
+            }
+
+            void unhandled_exception() const {
+                std::terminate();
+            }
+        };
+
+    private:
+        std::coroutine_handle<promise_type> m_h;
+
+        explicit Task(std::coroutine_handle<promise_type> h) : m_h{h} {}
+
+    public:
+
+        Task(Task&& other) noexcept : m_h{std::exchange(other.m_h, {})} {}
+
+        Task& operator=(Task&& other) noexcept {
+            std::swap(m_h, other.m_h);
+            return *this;
+        }
+
+        ~Task() {
+            if(m_h)
+                m_h.destroy();
+        }
+
+
+        bool await_ready() const noexcept {
+            return !m_h || m_h.done();
+        }
+
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+            m_h.promise().continuation = awaiting;
+            return m_h;
+        }
+
+        T await_resume() {
+            return m_h.promise().result();
+        }
+    };
+
+
+    /**
+     * @brief awaitable moving the coroutine to the executor
+     * @details
+     * The rest of the coroutine runs as a task of `ex`, after the tasks queued before it. Awaiting it on an
+     * event loop executor between chunks of work lets other events be handled, even if the loop reports
+     * no other threads (concurrency 0); on a thread pool it offloads the work from the current thread.
+     * Only with InlineExecutor it does nothing
+     * @warning the executor must run the queued task eventually (e.g. not a ThreadPool without threads)
+     */
+    template<Executor E>
+    auto schedule(E& ex) {
+        struct Awaiter {
+            E& ex;
+
+            bool await_ready() const {
+                return std::same_as<std::remove_cv_t<E>, InlineExecutor>;
+            }
+
+            void await_suspend(std::coroutine_handle<> h) const {
+                ex.execute([h] { h.resume(); });
+            }
+
+            void await_resume() const noexcept {}
+        };
+
+        return Awaiter{ex};
+    }
+
+
+    /**
+     * @brief starts a task without waiting for it, `on_done(result)` is called on the thread finishing it
+     */
+    template<typename T, typename F>
+    void start(Task<T> task, F on_done) {
+        detail::run(std::move(task), std::move(on_done));
+    }
+
+
+    /**
+     * @brief runs a task and blocks the calling thread until it is finished
+     * @warning must not be called on the thread of an executor the task is scheduled on
+     */
+    template<typename T>
+    T sync_wait(Task<T> task) {
+        std::mutex mtx;
+        std::condition_variable cv;
+        bool done{};
+        auto notify = [&] {
+            std::lock_guard lock(mtx);  // the waiter can not return before the notification is finished
+            done = true;
+            cv.notify_one();
+        };
+        auto wait = [&] {
+            std::unique_lock lock(mtx);
+            cv.wait(lock, [&] { return done; });
+        };
+
+        if constexpr (std::is_void_v<T>) {
+            start(std::move(task), notify);
+            wait();
+        }
+        else {
+            std::optional<T> res{};
+            start(std::move(task), [&](T v) { res.emplace(std::move(v)), notify(); });
+            wait();
+            return std::move(*res);
+        }
+    }
+
+
+    /**
+     * @brief awaitable `tree.build`: runs on the executor and moves itself to its queue after every subtree of about `chunk` hashes
+     * @details
+     * On an event loop executor other events are handled between the chunks; on a thread pool the build
+     * is offloaded from the awaiting thread, which is free until the task is finished.
+     * The subtrees and the layers above them are built like in `build_parallel`
+     * @param tree e.g. FixedSizeTree
+     * @warning the tree and the container are referenced by the task and must outlive it
+     */
+    template<typename Tree, std::ranges::random_access_range Container, Executor E>
+    Task<> build_async(Tree& tree, const Container& ccont, E& ex, const size_t chunk = size_t{1} << 12) {
+        co_await schedule(ex);
+        constexpr size_t leafs_n = Tree::get_leafs_n();
+        if constexpr (leafs_n == 1) {
+            tree.build(ccont);
+            co_return;
+        }
+
+        const size_t sub = std::min(std::bit_floor(std::max<size_t>(chunk / 2, 1)), std::bit_floor(leafs_n));   // 2·sub - 1 hashes
+        auto leaves = std::ranges::begin(ccont);
+        for(size_t b{};b < leafs_n / sub;++b) {
+            tree.build_subtree(leaves, b, sub);
+            co_await schedule(ex);
+        }
+
+        tree.build_top(leaves, leafs_n / sub * sub, sub);
+    }
+
+
+    /**
+     * @brief awaitable `tree.update` running on the executor
+     * @warning the tree and the data are referenced by the task and must outlive it
+     */
+    template<typename Tree, Executor E>
+    Task<bool> update_async(Tree& tree, const size_t idx, const auto& data, E& ex) {
+        co_await schedule(ex);
+        co_return tree.update(idx, data);
+    }
+
+
+    /**
+     * @brief awaitable `get_proofs`: runs on the executor and moves itself to its queue after every `chunk` proofs
+     * @warning the tree and the inputs are referenced by the task and must outlive it
+     */
+    template<typename Tree, std::ranges::random_access_range R, Executor E>
+    Task<std::vector<typename Tree::proof_type>> get_proofs_async(const Tree& tree, const R& data, E& ex, const size_t chunk = 64) {
+        co_await schedule(ex);
+        const size_t n = std::ranges::size(data);
+        std::vector<typename Tree::proof_type> proofs(n);
+        for(size_t i{};i < n;++i) {
+            proofs[i] = tree.get_proof(std::ranges::begin(data)[i]);
+            if((i + 1) % chunk == 0)
+                co_await schedule(ex);
+        }
+
+        co_return proofs;
+    }
+
+
+    /**
+     * @brief awaitable `verify_proofs`: runs on the executor and moves itself to its queue after every `chunk` checks
+     * @warning the tree and the inputs are referenced by the task and must outlive it
+     */
+    template<typename Tree, std::ranges::random_access_range R, std::ranges::random_access_range P, Executor E>
+    Task<std::vector<char>> verify_proofs_async(const Tree& tree, const R& data, const P& proofs, E& ex, const size_t chunk = 64) {
+        co_await schedule(ex);
+        const size_t n = std::min<size_t>(std::ranges::size(data), std::ranges::size(proofs));
+        std::vector<char> res(n);
+        for(size_t i{};i < n;++i) {
+            res[i] = tree.verify_proof(std::ranges::begin(data)[i], std::ranges::begin(proofs)[i]);
+            if((i + 1) % chunk == 0)
+                co_await schedule(ex);
+        }
+
+        co_return res;
+    }
+
+};
@@ -0,0 +1,276 @@
+/**
+ *  @file    merkle_cache.hpp
+ *  @brief   Bounded LRU cache of hashes keyed by fingerprints of their input, for rebuilding trees over mostly unchanged data
+ *  @author  https://github.com/gdaneek
+ *  @date    16.10.2026
+ *  @version 1.1
+ *  @see https://github.com/gdaneek/merkle-tree
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <list>
+#include <optional>
+#include <ranges>
+#include <unordered_map>
+#include <utility>
+
+namespace merkle {
+
+    /**
+     * @brief content-addressed cache of hashes with a memory budget and LRU eviction
+     * @details
+     * Maps the input of a hash function (the concatenated salt and leaf data, or the salt and the pair
+     * of child hashes) to its result. Inputs are looked up by a fixed-size Key: their length and two independent
+     * 64-bit fingerprints. The first one and the length select the entry, the second one is confirmed against
+     * the entry on every hit, so a leaf of any size costs the same few bytes. A tree built with a cache
+     * (see FixedSizeTree::build) looks up every leaf and node before hashing it; unchanged leaves hit,
+     * and so do the nodes whose children are unchanged, so a rebuild hashes only the changed leaves
+     * and their paths to the root.
+     *
+     * Every entry is charged the key size, the hash size and `entry_overhead`; when the total exceeds
+     * the budget, the least recently used entries are evicted.
+     * @warning fingerprints are not cryptographic: inputs crafted to collide in both of them get a wrong hit,
+     * so do not share a cache between trees of untrusted data
+     * @note not thread-safe
+     */
+    template<typename Hash>
+    class HashCache {
+    public:
+        /**
+         * @brief fixed-size lookup key of a hash input
+         */
+        struct Key {
+            uint64_t fingerprint; ///< selects the entry together with the size
+            uint64_t check; ///< independent fingerprint confirmed on a hit
+            uint64_t size; ///< input length in bytes
+
+            bool operator==(const Key& rhs) const {
+                return fingerprint == rhs.fingerprint && size == rhs.size;
+            }
+        };
+
+    private:
+        struct KeyHash {
+            size_t operator()(const Key& k) const {
+                return static_cast<size_t>(k.fingerprint);
+            }
+        };
+
+        struct Entry {
+            Key key;
+            Hash value;
+        };
+
+        using List = std::list<Entry>;
+
+        size_t m_budget;
+        size_t m_bytes{};
+        size_t m_hits{}, m_misses{}, m_evictions{};
+        List m_lru{}; ///< the most recently used first
+        std::unordered_map<Key, typename List::iterator, KeyHash> m_index{};
+
+
+        /**
+         * @brief two-lane word-at-a-time fingerprint, the result does not depend on how the input is split
+         */
+        class Fingerprint {
+            uint64_t m_a{0x9e3779b97f4a7c15}, m_b{0xc2b2ae3d27d4eb4f};
+            uint64_t m_size{};
+            std::array<char, 8> m_tail{};
+
+            static constexpr uint64_t mix(uint64_t x) {
+                x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9;
+                x = (x ^ (x >> 27)) * 0x94d049bb133111eb;
+                return x ^ (x >> 31);
+            }
+
+            void absorb(const char* p) {
+                uint64_t w{};
+                std::memcpy(&w, p, sizeof(w));
+                m_a = std::rotl((m_a ^ w) * 0x9e3779b97f4a7c15, 29);
+                m_b = std::rotl(m_b + w * 0xc2b2ae3d27d4eb4f, 31) * 0x165667b19e3779f9;
+            }
+
+        public:
+            void update(const char* p, size_t n) {
+                size_t used = m_size % 8;
+                m_size += n;
+                if(used) {
+                    const size_t take = std::min(n, 8 - used);
+                    std::memcpy(m_tail.data() + used, p, take);
+                    p += take, n -= take, used += take;
+                    if(used < 8)
+                        return;
+
+                    absorb(m_tail.data());
+                }
+
+                for(;n >= 8;p += 8, n -= 8)
+                    absorb(p);
+
+                std::memcpy(m_tail.data(), p, n);
+            }
+
+            Key finish() {
+                const size_t used = m_size % 8;
+                if(used) {
+                    std::fill(m_tail.begin() + used, m_tail.end(), 0);
+                    absorb(m_tail.data());
+                }
+
+                return {mix(m_a ^ m_size), mix(m_b + m_size), m_size};
+            }
+        };
+
+
+        static constexpr size_t cost() {
+            return sizeof(Key) + sizeof(Hash) + entry_overhead;
+        }
+
+
+        void evict() {
+            while(m_bytes > m_budget && !m_lru.empty()) {
+                m_bytes -= cost();
+                m_index.erase(m_lru.back().key);
+                m_lru.pop_back();
+                ++m_evictions;
+            }
+        }
+
+    public:
+        static constexpr size_t entry_overhead = 96; ///< estimate of the list and index nodes of an entry, in bytes
+
+
+        /**
+         * @param budget max memory of the entries in bytes (see entry_overhead)
+         */
+        explicit HashCache(const size_t budget) : m_budget{budget} {}
+
+        HashCache(const HashCache&) = delete;
+        HashCache& operator=(const HashCache&) = delete;
+
+
+        /**
+         * @brief fingerprints the bytes of a range, segment by segment for a segment list (bconcat::Segments)
+         */
+        template<typename Bytes>
+        static Key key(const Bytes& bytes) {
+            Fingerprint fp{};
+            if constexpr (std::ranges::contiguous_range<Bytes>)
+                fp.update(reinterpret_cast<const char*>(std::ranges::data(bytes)),
+                          std::ranges::size(bytes) * sizeof(*std::ranges::data(bytes)));
+            else if constexpr (requires { bytes.segments(); bytes.segment(0); }) {
+                for(size_t i{};i < bytes.segments();++i)
+                    fp.update(bytes.segment(i).data(), bytes.segment(i).size());
+            } else {
+                for(auto c : bytes) {
+                    const auto byte = static_cast<char>(c);
+                    fp.update(&byte, 1);
+                }
+            }
+
+            return fp.finish();
+        }
+
+
+        /**
+         * @return the cached hash of the input, marked as the most recently used, or nullopt
+         */
+        std::optional<Hash> find(const Key& input) {
+            auto it = m_index.find(input);
+            if(it == m_index.end() || it->second->key.check != input.check) {
+                ++m_misses;
+                return std::nullopt;
+            }
+
+            ++m_hits;
+            m_lru.splice(m_lru.begin(), m_lru, it->second);
+            return it->second->value;
+        }
+
+
+        /**
+         * @brief stores the hash of the input as the most recently used, then evicts entries over the budget
+         * @details an entry with the same fingerprint and size but another check is replaced
+         * @note nothing is stored if one entry is larger than the whole budget
+         */
+        void insert(const Key& input, const Hash& value) {
+            if(auto it = m_index.find(input);it != m_index.end()) {
+                it->second->key.check = input.check, it->second->value = value;
+                m_lru.splice(m_lru.begin(), m_lru, it->second);
+                return;
+            }
+
+            if(cost() > m_budget)
+                return;
+
+            m_lru.push_front({input, value});
+            m_index.emplace(input, m_lru.begin());
+            m_bytes += cost();
+            evict();
+        }
+
+
+        /**
+         * @brief returns the cached hash of the input or computes it with `f()` and stores it
+         */
+        template<typename F>
+        Hash get_or_compute(const Key& input, F&& f) {
+            if(auto hit = find(input))
+                return *hit;
+
+            Hash res = f();
+            insert(input, res);
+            return res;
+        }
+
+
+        /**
+         * @brief changes the budget, evicting entries over the new one
+         */
+        void set_budget(const size_t budget) {
+            m_budget = budget;
+            evict();
+        }
+
+
+        void clear() {
+            m_index.clear();
+            m_lru.clear();
+            m_bytes = 0;
+        }
+
+
+        size_t budget() const {
+            return m_budget;
+        }
+
+        size_t bytes() const {
+            return m_bytes;
+        }
+
+        size_t size() const {
+            return m_lru.size();
+        }
+
+        size_t hits() const {
+            return m_hits;
+        }
+
+        size_t misses() const {
+            return m_misses;
+        }
+
+        size_t evictions() const {
+            return m_evictions;
+        }
+    };
+
+};
@@ -0,0 +1,169 @@
+/**
+ *  @file    merkle_cdc.hpp
+ *  @brief   Content-defined chunking (FastCDC) of large inputs into tree leaves
+ *  @author  https://github.com/gdaneek
+ *  @date    16.10.2026
+ *  @version 1.1
+ *  @see https://github.com/gdaneek/merkle-tree
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace merkle {
+
+    namespace cdc {
+
+        /**
+         * @brief random 64-bit values of the bytes for the gear hash (splitmix64)
+         */
+        constexpr auto make_gear() {
+            std::array<uint64_t, 256> table{};
+            uint64_t x{0x9e3779b97f4a7c15};
+            for(auto&& v : table) {
+                uint64_t z = (x += 0x9e3779b97f4a7c15);
+                z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+                z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+                v = z ^ (z >> 31);
+            }
+
+            return table;
+        }
+
+        inline constexpr std::array<uint64_t, 256> gear = make_gear();
+    };
+
+
+    /**
+     * @brief FastCDC chunker: splits bytes at positions chosen by a gear rolling hash of the content
+     * @details
+     * A cut point depends only on the last 64 bytes before it, so an insertion or a deletion changes
+     * only the chunks around it and the following chunks (and their leaf hashes) stay the same.
+     * Chunks are not shorter than `min_size` (except the last one) and not longer than `max_size`.
+     * Normalized chunking uses a harder mask before `avg_size` and an easier one after it,
+     * which concentrates chunk sizes around the average.
+     * @note The gear hash is a serial dependency chain (one shift and add per byte), so the scan is not
+     * vectorized; the first `min_size` bytes of every chunk are skipped without hashing and the loop is unrolled
+     */
+    class FastCdc {
+    public:
+
+        struct Options {
+            size_t min_size{2048};
+            size_t avg_size{8192}; ///< expected chunk size, rounded down to a power of two
+            size_t max_size{65536};
+            unsigned normalization{2}; ///< number of mask bits added before and removed after the average size
+        };
+
+    private:
+
+        /**
+         * @brief mask of the highest bits, they depend on the last 64 bytes
+         */
+        static constexpr uint64_t mask(const unsigned bits) {
+            return bits? ~uint64_t{0} << (64 - std::min(bits, 63u)) : 0;
+        }
+
+        Options m_opts;
+        uint64_t m_mask_s, m_mask_l;
+
+    public:
+
+        constexpr FastCdc() : FastCdc(Options{}) {}
+
+        constexpr explicit FastCdc(const Options opts) : m_opts{opts} {
+            m_opts.max_size = std::max<size_t>(m_opts.max_size, 1);
+            m_opts.min_size = std::min(m_opts.min_size, m_opts.max_size);
+            m_opts.avg_size = std::clamp(m_opts.avg_size, m_opts.min_size, m_opts.max_size);
+
+            const unsigned bits = std::bit_width(std::max<size_t>(m_opts.avg_size, 1)) - 1;
+            m_mask_s = mask(bits + m_opts.normalization);
+            m_mask_l = mask(bits > m_opts.normalization? bits - m_opts.normalization : 1);
+        }
+
+
+        constexpr const Options& options() const {
+            return m_opts;
+        }
+
+
+        /**
+         * @brief finds the end of the chunk starting at the beginning of the data
+         * @return length of the chunk, the whole data if it is not longer than `min_size`
+         */
+        constexpr size_t cut(std::span<const char> data) const {
+            const size_t n = std::min(data.size(), m_opts.max_size);
+            if(n <= m_opts.min_size)
+                return n;
+
+            const size_t normal = std::min(n, m_opts.avg_size);
+            uint64_t hash{};
+            size_t i = m_opts.min_size;
+
+            auto scan = [&](const size_t end, const uint64_t mask) {
+                for(;i + 4 <= end;i += 4) {
+                    if(!((hash = (hash << 1) + cdc::gear[static_cast<uint8_t>(data[i])]) & mask)) return i + 1;
+                    if(!((hash = (hash << 1) + cdc::gear[static_cast<uint8_t>(data[i + 1])]) & mask)) return i + 2;
+                    if(!((hash = (hash << 1) + cdc::gear[static_cast<uint8_t>(data[i + 2])]) & mask)) return i + 3;
+                    if(!((hash = (hash << 1) + cdc::gear[static_cast<uint8_t>(data[i + 3])]) & mask)) return i + 4;
+                }
+                for(;i < end;++i)
+                    if(!((hash = (hash << 1) + cdc::gear[static_cast<uint8_t>(data[i])]) & mask))
+                        return i + 1;
+
+                return size_t{};
+            };
+
+            if(auto len = scan(normal, m_mask_s))
+                return len;
+            if(auto len = scan(n, m_mask_l))
+                return len;
+
+            return n;
+        }
+
+
+        /**
+         * @brief calls `f(chunk)` with consecutive chunks of the data
+         */
+        template<typename F>
+        constexpr void split(std::span<const char> data, F&& f) const {
+            while(!data.empty()) {
+                const size_t len = cut(data);
+                f(data.first(len));
+                data = data.subspan(len);
+            }
+        }
+
+
+        /**
+         * @return chunks of the data, they refer to the data and do not own memory
+         */
+        constexpr std::vector<std::span<const char>> chunks(std::span<const char> data) const {
+            std::vector<std::span<const char>> res{};
+            split(data, [&](auto chunk) { res.push_back(chunk); });
+            return res;
+        }
+
+
+        /**
+         * @brief appends `leaf_hash(chunk)` of every chunk of the data to a tree
+         * @param tree tree with `append_leaf_hash` (e.g. AppendOnlyTree)
+         * @return number of appended leaves
+         */
+        template<typename Tree>
+        size_t append(Tree& tree, std::span<const char> data) const {
+            size_t n{};
+            split(data, [&](auto chunk) { tree.append_leaf_hash(tree.leaf_hash(chunk)), ++n; });
+            return n;
+        }
+    };
+
+};
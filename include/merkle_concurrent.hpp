@@ -0,0 +1,406 @@
+/**
+ *  @file    merkle_concurrent.hpp
+ *  @brief   Tree with lock-free readers of immutable snapshots and epoch-based reclamation of old versions
+ *  @author  https://github.com/gdaneek
+ *  @date    16.10.2026
+ *  @version 1.1
+ *  @see https://github.com/gdaneek/merkle-tree
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "merkle.hpp"
+
+namespace merkle {
+
+    /**
+     * @brief fixed size tree that is read without locks while it is being updated
+     * @details
+     * The hashes (laid out like in FixedSizeTree) are stored in chunks of `CHUNK` hashes, and a version
+     * of the tree is a table of pointers to its chunks. An update copies only the chunks on the changed paths
+     * (copy-on-write), fills them, and publishes the new table with one atomic pointer swap.
+     *
+     * Readers take a Snapshot: they announce the current epoch in a slot and load the table, so the version
+     * can not be freed while the snapshot is alive, and read it without any locks. Tables and chunks replaced
+     * by an update are retired with the epoch of the update and freed once every announced epoch is newer
+     * (epoch-based reclamation), so the writer never waits for readers either.
+     *
+     * Updates are serialized by a mutex between writers.
+     * @tparam READERS max number of snapshots alive at once (slots); more readers yield until a slot is free
+     */
+    template<typename Hasher, uint64_t LEAFS_N, typename Hash = Hasher::value_type, typename Concatenator = bconcat::UnifiedConcatenator,
+             size_t CHUNK = 512, size_t READERS = 128>
+    class ConcurrentTree : public TreeBase<ConcurrentTree<Hasher, LEAFS_N, Hash, Concatenator, CHUNK, READERS>, Hasher, Concatenator> {
+
+        using Base = TreeBase<ConcurrentTree<Hasher, LEAFS_N, Hash, Concatenator, CHUNK, READERS>, Hasher, Concatenator>;
+
+        static_assert(LEAFS_N > 1, "a tree of one leaf has nothing to update concurrently");
+
+        static constexpr size_t tree_height = Base::height(LEAFS_N);
+        static constexpr size_t SIZE = calc_tree_size(LEAFS_N);
+        static constexpr size_t chunks_n = (SIZE + CHUNK - 1) / CHUNK;
+
+        using Chunk = std::array<Hash, CHUNK>;
+
+        struct Version {
+            std::array<Chunk*, chunks_n> chunks{};
+        };
+
+        struct Retired {
+            uint64_t epoch;
+            Version* version;
+            std::vector<Chunk*> chunks;
+        };
+
+        struct alignas(64) Slot {
+            std::atomic<uint64_t> epoch{}; ///< announced epoch + 1, 0 if the slot is free
+        };
+
+        static constexpr auto layers() {
+            std::array<size_t, tree_height + 1> offset{}, len{};
+            len[0] = LEAFS_N;
+            for(size_t k{};k < tree_height;++k)
+                offset[k + 1] = offset[k] + len[k] + (len[k] & 1), len[k + 1] = (len[k] + 1) >> 1;
+
+            return std::make_pair(offset, len);
+        }
+
+        std::atomic<Version*> m_current{};
+        std::atomic<uint64_t> m_epoch{1};
+        mutable std::array<Slot, READERS> m_slots{};
+
+        std::mutex m_write_mtx;
+        std::vector<Retired> m_retired{}; ///< guarded by m_write_mtx
+
+
+        static const Hash& at(const Version& v, const size_t pos) {
+            return (*v.chunks[pos / CHUNK])[pos % CHUNK];
+        }
+
+
+        /**
+         * @brief new version being written, the chunks are copied on the first write
+         */
+        class Draft {
+            Version* m_v;
+            std::array<bool, chunks_n> m_own{};
+            std::vector<Chunk*> m_replaced{};
+
+        public:
+            explicit Draft(const Version& base) : m_v{new Version(base)} {}
+
+            Hash& operator[](const size_t pos) {
+                const size_t c = pos / CHUNK;
+                if(!m_own[c]) {
+                    m_replaced.push_back(m_v->chunks[c]);
+                    m_v->chunks[c] = new Chunk(*m_v->chunks[c]);
+                    m_own[c] = true;
+                }
+
+                return (*m_v->chunks[c])[pos % CHUNK];
+            }
+
+            const Hash& get(const size_t pos) const {
+                return at(*m_v, pos);
+            }
+
+            Version* version() const {
+                return m_v;
+            }
+
+            std::vector<Chunk*>& replaced() {
+                return m_replaced;
+            }
+        };
+
+
+        /**
+         * @brief installs the draft and retires what it replaced
+         */
+        void publish(Draft& draft) {
+            Version* old = m_current.exchange(draft.version(), std::memory_order_seq_cst);
+            const uint64_t epoch = m_epoch.fetch_add(1, std::memory_order_seq_cst) + 1;
+            m_retired.push_back({epoch, old, std::move(draft.replaced())});
+            reclaim_locked();
+        }
+
+
+        void reclaim_locked() {
+            uint64_t oldest = m_epoch.load(std::memory_order_seq_cst);
+            for(auto& slot : m_slots)
+                if(auto e = slot.epoch.load(std::memory_order_seq_cst))
+                    oldest = std::min(oldest, e - 1);
+
+            auto keep = std::partition(m_retired.begin(), m_retired.end(), [&](auto& r) { return r.epoch > oldest; });
+            for(auto it = keep;it != m_retired.end();++it) {
+                delete it->version;
+                for(auto c : it->chunks)
+                    delete c;
+            }
+            m_retired.erase(keep, m_retired.end());
+        }
+
+    public:
+        using hash_type = Hash;
+        using proof_type = std::pair<Hash, std::array<std::pair<Hash, bool>, tree_height + 1>>; ///< same as FixedSizeTree::proof_type
+
+
+        /**
+         * @brief immutable view of one version of the tree, it keeps the version alive
+         */
+        class Snapshot {
+            Slot* m_slot{};
+            const Version* m_v{};
+
+        public:
+            Snapshot() = default;
+
+            explicit Snapshot(const ConcurrentTree& tree) {
+                const size_t start = std::hash<std::thread::id>{}(std::this_thread::get_id());
+                while(!m_slot) {
+                    for(size_t n{};n < READERS && !m_slot;++n) {
+                        auto& slot = tree.m_slots[(start + n) % READERS];
+                        uint64_t expected{};
+                        if(!slot.epoch.load(std::memory_order_relaxed)
+                           && slot.epoch.compare_exchange_strong(expected, tree.m_epoch.load(std::memory_order_seq_cst) + 1, std::memory_order_seq_cst))
+                            m_slot = &slot;
+                    }
+
+                    if(!m_slot)
+                        std::this_thread::yield();   // all slots are taken, let their readers finish
+                }
+
+                m_v = tree.m_current.load(std::memory_order_seq_cst);
+            }
+
+            Snapshot(Snapshot&& other) noexcept
+            : m_slot{std::exchange(other.m_slot, nullptr)}, m_v{std::exchange(other.m_v, nullptr)} {}
+
+            Snapshot& operator=(Snapshot&& other) noexcept {
+                std::swap(m_slot, other.m_slot), std::swap(m_v, other.m_v);
+                return *this;
+            }
+
+            ~Snapshot() {
+                if(m_slot)
+                    m_slot->epoch.store(0, std::memory_order_release);
+            }
+
+
+            Hash root() const {
+                return at(*m_v, SIZE - 1);
+            }
+
+
+            /**
+             * @return hash at the position `pos` of the flattened tree (laid out like FixedSizeTree::data)
+             */
+            const Hash& operator[](const size_t pos) const {
+                return at(*m_v, pos);
+            }
+
+
+            /**
+             * @return hash of the leaf `idx`
+             */
+            Hash leaf(const size_t idx) const {
+                return at(*m_v, idx);
+            }
+
+
+            /**
+             * @brief proof of inclusion of the leaf `idx` in this version, in the format of FixedSizeTree::get_proof
+             * @note O(logN) complexity, the default value if the index is out of range
+             */
+            proof_type get_proof(size_t idx) const {
+                proof_type res{};
+                if(idx >= LEAFS_N)
+                    return res;
+
+                auto [offset, len] = layers();
+                res.first = at(*m_v, idx);
+                for(size_t i{};i < tree_height;++i, idx >>= 1)
+                    res.second[i] = std::make_pair(at(*m_v, offset[i] + (idx ^ 1)), (bool)(idx & 1));
+                res.second[tree_height] = std::make_pair(root(), bool{});
+
+                return res;
+            }
+        };
+
+
+        ConcurrentTree() {
+            auto v = new Version{};
+            for(auto& c : v->chunks)
+                c = new Chunk{};
+            m_current.store(v);
+        }
+
+        template<typename T>
+        explicit ConcurrentTree(T&& _data) : ConcurrentTree() {
+            build(std::forward<T>(_data));
+        }
+
+        ConcurrentTree(const ConcurrentTree&) = delete;
+        ConcurrentTree& operator=(const ConcurrentTree&) = delete;
+
+        /**
+         * @warning all snapshots must be destroyed before the tree
+         */
+        ~ConcurrentTree() {
+            for(auto& r : m_retired) {
+                delete r.version;
+                for(auto c : r.chunks)
+                    delete c;
+            }
+
+            auto v = m_current.load();
+            for(auto c : v->chunks)
+                delete c;
+            delete v;
+        }
+
+
+        /**
+         * @brief lock-free access to the current version
+         * @warning at most READERS snapshots can be alive at once, further calls wait (yielding the CPU)
+         * until a snapshot is destroyed, so a thread must not hold READERS snapshots and take one more
+         */
+        Snapshot snapshot() const {
+            return Snapshot(*this);
+        }
+
+
+        Hash root() const {
+            return snapshot().root();
+        }
+
+
+        static constexpr auto get_leafs_n() {
+            return LEAFS_N;
+        }
+
+
+        /**
+         * @brief snapshot of the current version indexed like FixedSizeTree::data, used by `find_leaf` / `verify`
+         */
+        Snapshot data() const {
+            return snapshot();
+        }
+
+
+        /**
+         * @brief builds a new version from a container of LEAFS_N elements and publishes it
+         */
+        auto& build(auto&& ccont) {
+            std::lock_guard lock(m_write_mtx);
+            Draft draft(*m_current.load());
+
+            auto [offset, len] = layers();
+            size_t it{};
+            for(auto&& x : ccont)
+                draft[it++] = this->leaf_hash(x);
+
+            for(size_t k{};k < tree_height;++k) {
+                if(len[k] & 1)
+                    draft[offset[k] + len[k]] = draft.get(offset[k] + len[k] - 1);
+                for(size_t i{};i < len[k + 1];++i)
+                    draft[offset[k + 1] + i] = this->node_hash(draft.get(offset[k] + 2 * i), draft.get(offset[k] + 2 * i + 1));
+            }
+
+            publish(draft);
+            return *this;
+        }
+
+
+        /**
+         * @brief replaces the data of many leaves and publishes the result as one version
+         * @param changes range of pairs (leaf index, data), indices out of range are skipped
+         * @details Every changed node is hashed once, however many changed leaves are below it
+         * @return number of applied changes
+         */
+        template<typename Changes>
+        size_t update(const Changes& changes) {
+            std::lock_guard lock(m_write_mtx);
+            Draft draft(*m_current.load());
+
+            auto [offset, len] = layers();
+            std::vector<size_t> dirty{};
+            for(auto&& [idx, data] : changes)
+                if(idx < LEAFS_N)
+                    draft[idx] = this->leaf_hash(data), dirty.push_back(idx);
+
+            const size_t applied = dirty.size();
+            std::sort(dirty.begin(), dirty.end());
+            dirty.erase(std::unique(dirty.begin(), dirty.end()), dirty.end());
+
+            for(size_t k{};k < tree_height && !dirty.empty();++k) {
+                if((len[k] & 1) && dirty.back() == len[k] - 1)
+                    draft[offset[k] + len[k]] = draft.get(offset[k] + len[k] - 1);
+
+                size_t n{};
+                for(size_t i : dirty)
+                    if(!n || dirty[n - 1] != (i >> 1))
+                        dirty[n++] = i >> 1;
+                dirty.resize(n);
+
+                for(size_t p : dirty)
+                    draft[offset[k + 1] + p] = this->node_hash(draft.get(offset[k] + 2 * p), draft.get(offset[k] + 2 * p + 1));
+            }
+
+            publish(draft);
+            return applied;
+        }
+
+
+        /**
+         * @brief replaces the data of a leaf and publishes the new version
+         * @return false if the index is out of range
+         */
+        bool update(const size_t idx, auto&& data) {
+            return update(std::array{std::pair<size_t, const std::remove_cvref_t<decltype(data)>&>(idx, data)}) == 1;
+        }
+
+
+        /**
+         * @brief checks a proof of inclusion created by Snapshot::get_proof
+         */
+        template<typename Proof>
+        bool verify_proof(auto&& data, Proof&& proof) const {
+            Hash curr_hash = this->leaf_hash(data);
+            for(size_t i{};i + 1 < proof.size();++i)
+                curr_hash = proof[i].second? this->node_hash(proof[i].first, curr_hash)
+                                           : this->node_hash(curr_hash, proof[i].first);
+
+            return curr_hash == proof[proof.size() - 1].first;
+        }
+
+
+        /**
+         * @brief frees retired versions no snapshot can see anymore (updates do it too)
+         */
+        void reclaim() {
+            std::lock_guard lock(m_write_mtx);
+            reclaim_locked();
+        }
+
+
+        /**
+         * @return number of updates whose replaced chunks are not freed yet
+         */
+        size_t retired() {
+            std::lock_guard lock(m_write_mtx);
+            return m_retired.size();
+        }
+    };
+
+};
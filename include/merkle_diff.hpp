@@ -0,0 +1,98 @@
+/**
+ *  @file    merkle_diff.hpp
+ *  @brief   Search of differing leaves between two Merkle trees of the same shape
+ *  @author  https://github.com/gdaneek
+ *  @date    16.10.2026
+ *  @version 1.1
+ *  @see https://github.com/gdaneek/merkle-tree
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace merkle {
+
+    /**
+     * @brief requires a callable returning hashes of a layer range of some (possibly remote) tree
+     * @details
+     * `f(layer, begin, end)` must return an indexable object with hashes of nodes [begin, end) of the layer,
+     * layers are numbered as in `get_layer` (0 for the root, height for the leaves)
+     */
+    template<typename F>
+    concept LayerSource = requires(F f, size_t layer, size_t begin, size_t end) {
+        { f(layer, begin, end)[0] };
+    };
+
+
+    using LeafRanges = std::vector<std::pair<size_t, size_t>>; ///< sorted disjoint ranges [first, second) of leaf indices
+
+
+    /**
+     * @brief finds leaves that differ between a local tree and a tree available only through layer requests
+     * @details
+     * Descends from the root layer by layer and requests only children of the nodes that differ,
+     * identical subtrees are pruned. Requested indices are grouped into contiguous ranges,
+     * so the number of `remote` calls per layer is at most the number of differing nodes of the previous one.
+     * Both trees must have the same number of leaves.
+     * @param local tree providing `get_layer`, `height` and `get_leafs_n`
+     * @param remote source of the hashes of the other tree
+     * @return ranges of leaf indices whose hashes differ
+     * @note O(d·logN) hashes are compared and transferred, where d is the number of differing leaves
+     */
+    template<typename Tree, typename Source> requires LayerSource<Source>
+    LeafRanges diff(const Tree& local, Source&& remote) {
+        const size_t height = local.height(), leafs_n = local.get_leafs_n();
+
+        std::vector<size_t> real_n(height + 1);  // number of nodes without copies of odd tails
+        real_n[height] = leafs_n;
+        for(size_t l = height;l;--l)
+            real_n[l - 1] = (real_n[l] + 1) >> 1;
+
+        std::vector<size_t> frontier{}, next{};
+        if(!(remote(0, 0, 1)[0] == local.get_layer(0).first[0]))
+            frontier.push_back(0);
+
+        for(size_t l = 1;l <= height && !frontier.empty();++l) {
+            auto ldata = local.get_layer(l).first;
+            next.clear();
+
+            for(size_t i{};i < frontier.size();) {
+                size_t begin = frontier[i] << 1, end = begin;   // children of adjacent nodes form one range
+                for(;i < frontier.size() && frontier[i] << 1 == end;++i)
+                    end = std::min((frontier[i] << 1) + 2, real_n[l]);
+
+                auto rdata = remote(l, begin, end);
+                for(size_t j = begin;j < end;++j)
+                    if(!(rdata[j - begin] == ldata[j]))
+                        next.push_back(j);
+            }
+
+            std::swap(frontier, next);
+        }
+
+        LeafRanges ranges{};
+        for(auto idx : frontier) {
+            if(!ranges.empty() && ranges.back().second == idx)
+                ++ranges.back().second;
+            else ranges.emplace_back(idx, idx + 1);
+        }
+
+        return ranges;
+    }
+
+
+    /**
+     * @brief finds leaves that differ between two trees of the same type
+     * @note O(d·logN) complexity where d is the number of differing leaves
+     */
+    template<typename Tree> requires (!LayerSource<Tree>)
+    LeafRanges diff(const Tree& lhs, const Tree& rhs) {
+        return diff(lhs, [&rhs](size_t layer, size_t begin, size_t) { return rhs.get_layer(layer).first + begin; });
+    }
+
+};
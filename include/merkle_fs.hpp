@@ -0,0 +1,904 @@
+/**
+ *  @file    merkle_fs.hpp
+ *  @brief   Building Merkle trees over files with parallel leaf hashing: directories and chunked blobs
+ *  @author  https://github.com/gdaneek
+ *  @date    16.10.2026
+ *  @version 1.1
+ *  @see https://github.com/gdaneek/merkle-tree
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "merkle_parallel.hpp"
+
+namespace merkle {
+
+    /**
+     * @brief FIFO queue with a limited capacity, blocks producers when full and consumers when empty
+     */
+    template<typename T>
+    class BoundedQueue {
+        std::mutex m_mtx;
+        std::condition_variable m_not_full, m_not_empty;
+        std::deque<T> m_items{};
+        size_t m_capacity;
+        bool m_closed{};
+
+    public:
+
+        explicit BoundedQueue(const size_t capacity) : m_capacity{std::max<size_t>(capacity, 1)} {}
+
+
+        void push(T item) {
+            std::unique_lock lock(m_mtx);
+            m_not_full.wait(lock, [this] { return m_items.size() < m_capacity; });
+            m_items.push_back(std::move(item));
+            m_not_empty.notify_one();
+        }
+
+
+        /**
+         * @return next item or nothing if the queue is closed and empty
+         */
+        std::optional<T> pop() {
+            std::unique_lock lock(m_mtx);
+            m_not_empty.wait(lock, [this] { return !m_items.empty() || m_closed; });
+            if(m_items.empty())
+                return std::nullopt;
+
+            auto item = std::move(m_items.front());
+            m_items.pop_front();
+            m_not_full.notify_one();
+            return item;
+        }
+
+
+        /**
+         * @brief adds the item if the queue is not full, does not block
+         * @return false if the queue is full, the item is not moved then
+         */
+        bool try_push(T& item) {
+            std::lock_guard lock(m_mtx);
+            if(m_items.size() >= m_capacity)
+                return false;
+
+            m_items.push_back(std::move(item));
+            m_not_empty.notify_one();
+            return true;
+        }
+
+
+        /**
+         * @return next item or nothing if the queue is empty, does not block
+         */
+        std::optional<T> try_pop() {
+            std::lock_guard lock(m_mtx);
+            if(m_items.empty())
+                return std::nullopt;
+
+            auto item = std::move(m_items.front());
+            m_items.pop_front();
+            m_not_full.notify_one();
+            return item;
+        }
+
+
+        /**
+         * @brief wakes up all consumers, `pop` returns nothing once the queue is drained
+         */
+        void close() {
+            std::lock_guard lock(m_mtx);
+            m_closed = true;
+            m_not_empty.notify_all();
+        }
+    };
+
+
+    /**
+     * @brief read-only contents of a file: memory mapping for large files, buffer for small ones
+     */
+    class FileData {
+        const char* m_map{}; ///< mapped region or nullptr
+        std::vector<char> m_buf{}; ///< contents of a small file
+        size_t m_size{};
+
+    public:
+
+        FileData() = default;
+
+        FileData(FileData&& other) noexcept
+        : m_map{std::exchange(other.m_map, nullptr)}, m_buf{std::move(other.m_buf)}, m_size{std::exchange(other.m_size, 0)} {}
+
+        FileData& operator=(FileData&& other) noexcept {
+            std::swap(m_map, other.m_map), std::swap(m_buf, other.m_buf), std::swap(m_size, other.m_size);
+            return *this;
+        }
+
+        ~FileData() {
+            if(m_map)
+                munmap(const_cast<char*>(m_map), m_size);
+        }
+
+
+        /**
+         * @brief opens a file and starts reading it
+         * @details
+         * Files not smaller than `mmap_threshold` are mapped, and the kernel is asked to read them ahead
+         * asynchronously, so the disk keeps working while previous files are being hashed.
+         * Smaller files are read with one `read` call
+         * @return file contents or nothing if the file can not be read
+         */
+        static std::optional<FileData> open(const std::filesystem::path& path, const size_t mmap_threshold) {
+            int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if(fd < 0)
+                return std::nullopt;
+
+            struct stat st{};
+            FileData file{};
+            bool ok = !fstat(fd, &st);
+            file.m_size = ok? static_cast<size_t>(st.st_size) : 0;
+
+            if(ok && file.m_size >= mmap_threshold && file.m_size) {
+                void* map = mmap(nullptr, file.m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if((ok = map != MAP_FAILED)) {
+                    madvise(map, file.m_size, MADV_SEQUENTIAL);
+                    madvise(map, file.m_size, MADV_WILLNEED);
+                    file.m_map = static_cast<const char*>(map);
+                }
+            }
+            else if(ok) {
+                file.m_buf.resize(file.m_size);
+                for(size_t done{};ok && done < file.m_size;) {
+                    auto n = ::read(fd, file.m_buf.data() + done, file.m_size - done);
+                    ok = n > 0, done += ok? n : 0;
+                }
+            }
+
+            ::close(fd);
+            if(!ok)
+                return std::nullopt;
+
+            return file;
+        }
+
+
+        std::span<const char> bytes() const {
+            return m_map? std::span<const char>(m_map, m_size) : std::span<const char>(m_buf);
+        }
+    };
+
+
+    /**
+     * @brief set of equally sized aligned I/O buffers in one allocation
+     * @details
+     * `headroom` bytes before every buffer belong to it, builders write the leaf salt there
+     * to hash the read data in place
+     */
+    class ReadBuffers {
+        std::unique_ptr<char, decltype(&std::free)> m_mem{nullptr, &std::free};
+        size_t m_n, m_size, m_headroom, m_stride;
+
+    public:
+
+        /**
+         * @param n number of buffers
+         * @param size capacity of one buffer
+         * @param alignment alignment of the buffers, rounded up to a power of two not less than 64
+         */
+        ReadBuffers(const size_t n, const size_t size, const size_t alignment)
+        : m_n{std::max<size_t>(n, 1)}, m_size{size}, m_headroom{std::bit_ceil(std::max<size_t>(alignment, 64))} {
+            m_stride = m_headroom + (m_size + m_headroom - 1) / m_headroom * m_headroom;
+            m_mem.reset(static_cast<char*>(std::aligned_alloc(m_headroom, m_n * m_stride)));
+        }
+
+
+        size_t count() const {
+            return m_n;
+        }
+
+        size_t buffer_size() const {
+            return m_size;
+        }
+
+        size_t headroom() const {
+            return m_headroom;
+        }
+
+
+        char* operator[](const size_t i) const {
+            return m_mem.get() + i * m_stride + m_headroom;
+        }
+
+
+        /**
+         * @return memory of the i-th buffer including its headroom
+         */
+        std::span<char> region(const size_t i) const {
+            return {m_mem.get() + i * m_stride, m_stride};
+        }
+    };
+
+
+    /**
+     * @brief finished read of an asynchronous reader
+     */
+    struct ReadCompletion {
+        uint64_t tag; ///< value passed to `submit`
+        size_t buf; ///< index of the buffer with the data
+        ssize_t result; ///< number of bytes read or -errno
+    };
+
+
+    /**
+     * @brief requires an asynchronous positioned reader into its own buffers
+     * @details
+     * `submit(fd, offset, len, buf, tag)` starts reading `len` bytes at `offset` into the buffer `buf`,
+     * `wait()` blocks until some submitted read is finished. The caller owns a buffer from the submission
+     * until it is reused, so the number of reads in flight never exceeds the number of buffers.
+     */
+    template<typename R>
+    concept AsyncReader = requires(R& r, const int fd, const uint64_t offset, const size_t n) {
+        { r.buffers() } -> std::convertible_to<const ReadBuffers&>;
+        r.submit(fd, offset, n, n, uint64_t{});
+        { r.wait() } -> std::same_as<ReadCompletion>;
+    };
+
+
+    /**
+     * @brief AsyncReader over a pool of threads making blocking `pread` calls
+     * @details Portable fallback for systems without io_uring (see UringReader)
+     */
+    class PreadReader {
+    public:
+
+        struct Options {
+            size_t buffers{16}; ///< number of buffers, it limits reads in flight
+            size_t buffer_size{size_t{1} << 20};
+            size_t alignment{4096};
+            size_t threads{4}; ///< number of reading threads
+        };
+
+    private:
+
+        struct Request {
+            int fd;
+            uint64_t offset;
+            size_t len, buf;
+            uint64_t tag;
+        };
+
+        ReadBuffers m_bufs;
+        BoundedQueue<Request> m_requests;
+        BoundedQueue<ReadCompletion> m_done;
+        std::vector<std::thread> m_threads{};
+
+    public:
+
+        explicit PreadReader(const Options opts)
+        : m_bufs{opts.buffers, opts.buffer_size, opts.alignment}, m_requests{m_bufs.count()}, m_done{m_bufs.count()} {
+            for(size_t i{};i < std::max<size_t>(opts.threads, 1);++i)
+                m_threads.emplace_back([this] {
+                    while(auto req = m_requests.pop()) {
+                        size_t done{};
+                        ssize_t r{};
+                        while(done < req->len && (r = ::pread(req->fd, m_bufs[req->buf] + done, req->len - done, req->offset + done)) != 0) {
+                            if(r < 0 && errno == EINTR)
+                                continue;
+                            if(r < 0)
+                                break;
+                            done += r;
+                        }
+
+                        m_done.push({req->tag, req->buf, r < 0? -errno : static_cast<ssize_t>(done)});
+                    }
+                });
+        }
+
+        PreadReader(const PreadReader&) = delete;
+        PreadReader& operator=(const PreadReader&) = delete;
+
+        ~PreadReader() {
+            m_requests.close();
+            for(auto&& t : m_threads)
+                t.join();
+        }
+
+
+        const ReadBuffers& buffers() const {
+            return m_bufs;
+        }
+
+
+        void submit(const int fd, const uint64_t offset, const size_t len, const size_t buf, const uint64_t tag) {
+            m_requests.push({fd, offset, std::min(len, m_bufs.buffer_size()), buf, tag});
+        }
+
+
+        ReadCompletion wait() {
+            return *m_done.pop();
+        }
+    };
+
+
+    /**
+     * @brief bounded queue of jobs processed by helper tasks on an executor and by the producing thread
+     * @details
+     * Up to `workers` copies of the worker loop are spawned on the executor. When the queue is full
+     * the producer processes a job itself instead of blocking, and `finish` drains the rest on the calling
+     * thread, so all jobs are done even if the executor has no free threads
+     */
+    template<typename Job, typename F>
+    class JobQueue {
+        BoundedQueue<Job> m_queue;
+        F m_process;
+        TaskGroup m_group{};
+
+    public:
+
+        JobQueue(ExecutorRef ex, const size_t workers, const size_t depth, F process)
+        : m_queue{depth}, m_process{std::move(process)} {
+            for(size_t w{};w < std::min(workers, ex.concurrency());++w)
+                m_group.spawn(ex, [this] {
+                    while(auto job = m_queue.pop())
+                        m_process(*job);
+                });
+        }
+
+        ~JobQueue() {
+            finish();
+        }
+
+
+        void push(Job job) {
+            while(!m_queue.try_push(job))
+                help();
+        }
+
+
+        /**
+         * @brief processes one queued job on the calling thread
+         * @return false if the queue is empty
+         */
+        bool help() {
+            auto job = m_queue.try_pop();
+            if(job)
+                m_process(*job);
+
+            return job.has_value();
+        }
+
+
+        /**
+         * @brief processes the remaining jobs and waits for the helpers
+         */
+        void finish() {
+            m_queue.close();
+            while(help());
+            m_group.wait();
+        }
+    };
+
+
+    /**
+     * @brief hashes all regular files of a directory into leaves of a tree
+     * @details
+     * The calling thread walks the directory and opens files (see FileData::open) one after another,
+     * while a pool of workers hashes the already opened ones. The number of opened but not yet hashed files
+     * is limited by the queue depth.
+     * The leaf of a file is `leaf_hash(path length, relative path, contents)`, leaves are appended
+     * in the lexicographic order of relative paths, so the root does not depend on the scheduling.
+     * File contents go to the hasher state straight from the mapping or the read buffer (see TreeBase::segmented_leaf_hash).
+     * @tparam Tree tree with `append_leaf_hash` and `segmented_leaf_hash` (e.g. AppendOnlyTree)
+     */
+    template<typename Tree>
+    class FileTreeBuilder {
+    public:
+
+        struct Options {
+            size_t workers{std::max(1u, std::thread::hardware_concurrency())}; ///< number of hashing threads (tasks on an executor)
+            size_t queue_depth{}; ///< max opened and not yet hashed files, 0 for 2·workers
+            size_t mmap_threshold{size_t{1} << 16}; ///< files from this size are mapped instead of read
+        };
+
+        struct Stats {
+            size_t files{}; ///< number of hashed files
+            size_t errors{}; ///< files that could not be read, they are not added to the tree
+            uint64_t bytes{}; ///< total size of hashed files
+            double seconds{};
+
+            double gbps() const {
+                return seconds > 0? bytes / seconds / 1e9 : 0;
+            }
+        };
+
+    private:
+        Tree& m_tree;
+        Options m_opts;
+        std::optional<ExecutorRef> m_ex{}; ///< shared executor, own threads are started if it is not set
+
+        struct Job {
+            size_t idx;
+            FileData data;
+            size_t buf{npos}; ///< reader buffer with the contents instead of `data`
+            size_t len{};
+        };
+
+        static constexpr size_t npos = ~size_t{0};
+
+
+        size_t depth() const {
+            return m_opts.queue_depth? m_opts.queue_depth : 2 * m_opts.workers;
+        }
+
+
+        /**
+         * @return sorted paths of regular files relative to the root
+         */
+        static std::vector<std::string> list(const std::filesystem::path& root) {
+            namespace fs = std::filesystem;
+            std::vector<std::string> paths{};
+            std::error_code ec{};
+            for(fs::recursive_directory_iterator it(root, ec), end;it != end;it.increment(ec))
+                if(it->is_regular_file(ec))
+                    paths.push_back(fs::relative(it->path(), root, ec).generic_string());
+            std::sort(paths.begin(), paths.end());
+
+            return paths;
+        }
+
+    public:
+
+        explicit FileTreeBuilder(Tree& tree, Options opts = {}) : m_tree{tree}, m_opts{opts} {}
+
+        /**
+         * @param ex executor for the hashing tasks, the building thread takes part in hashing too
+         */
+        template<Executor E>
+        FileTreeBuilder(Tree& tree, E& ex, Options opts = {}) : m_tree{tree}, m_opts{opts}, m_ex{ExecutorRef(ex)} {}
+
+
+        /**
+         * @brief hashes files of the directory and appends their leaves to the tree
+         * @param root directory to walk recursively (symbolic links are not followed)
+         */
+        Stats build(const std::filesystem::path& root) {
+            auto start = std::chrono::steady_clock::now();
+            Stats stats{};
+
+            auto paths = list(root);
+            std::vector<typename Tree::hash_type> leaves(paths.size());
+            std::vector<char> hashed(paths.size());
+
+            auto hash = [&](Job& job) {
+                auto& path = paths[job.idx];
+                leaves[job.idx] = m_tree.segmented_leaf_hash(uint64_t{path.size()}, path, job.data.bytes());
+                hashed[job.idx] = true;
+            };
+
+            ThreadPool own(m_ex? 0 : std::max<size_t>(m_opts.workers, 1));
+            JobQueue<Job, decltype(hash)> queue(m_ex? *m_ex : ExecutorRef(own), m_opts.workers, depth(), hash);
+
+            for(size_t i{};i < paths.size();++i) {
+                if(auto data = FileData::open(root / paths[i], m_opts.mmap_threshold)) {
+                    stats.bytes += data->bytes().size();
+                    queue.push({i, std::move(*data)});
+                }
+                else ++stats.errors;
+            }
+
+            queue.finish();
+
+            for(size_t i{};i < leaves.size();++i)
+                if(hashed[i])
+                    m_tree.append_leaf_hash(leaves[i]), ++stats.files;
+
+            stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            return stats;
+        }
+
+
+        /**
+         * @brief hashes files of the directory reading them with an asynchronous reader
+         * @details
+         * Files fitting into a reader buffer are read with one request each, up to the number of buffers
+         * in flight, and every completed read goes straight to the hashing workers, which release the buffer.
+         * Larger files are opened as in `build(root)`. The tree is the same as with `build(root)`
+         * @param reader e.g. UringReader or PreadReader
+         */
+        template<AsyncReader Reader>
+        Stats build(const std::filesystem::path& root, Reader& reader) {
+            auto start = std::chrono::steady_clock::now();
+            Stats stats{};
+
+            auto paths = list(root);
+            std::vector<typename Tree::hash_type> leaves(paths.size());
+            std::vector<char> hashed(paths.size());
+            std::vector<std::pair<int, size_t>> reads(paths.size(), {-1, 0});  // descriptors and sizes of files in flight
+
+            auto&& bufs = reader.buffers();
+            BoundedQueue<size_t> free_bufs(bufs.count());
+            for(size_t i{};i < bufs.count();++i)
+                free_bufs.push(i);
+
+            auto hash = [&](Job& job) {
+                auto& path = paths[job.idx];
+                auto bytes = job.buf == npos? job.data.bytes() : std::span<const char>(bufs[job.buf], job.len);
+                leaves[job.idx] = m_tree.segmented_leaf_hash(uint64_t{path.size()}, path, bytes);
+                hashed[job.idx] = true;
+                if(job.buf != npos)
+                    free_bufs.push(job.buf);
+            };
+
+            ThreadPool own(m_ex? 0 : std::max<size_t>(m_opts.workers, 1));
+            JobQueue<Job, decltype(hash)> queue(m_ex? *m_ex : ExecutorRef(own), m_opts.workers, depth(), hash);
+
+            auto acquire = [&](const bool wait) {   // hashes queued files itself while waiting for a buffer
+                auto buf = free_bufs.try_pop();
+                while(!buf && wait && queue.help())
+                    buf = free_bufs.try_pop();
+
+                return buf || !wait? buf : free_bufs.pop();
+            };
+
+            std::pair<int, size_t> opened{-1, 0};
+            for(size_t i{}, in_flight{};i < paths.size() || in_flight;) {
+                if(i < paths.size()) {
+                    struct stat st{};
+                    if(opened.first < 0) {
+                        int fd = ::open((root / paths[i]).c_str(), O_RDONLY | O_CLOEXEC);
+                        if(fd >= 0 && !fstat(fd, &st) && st.st_size && static_cast<size_t>(st.st_size) <= bufs.buffer_size())
+                            opened = {fd, static_cast<size_t>(st.st_size)};
+                        else {
+                            if(fd >= 0)
+                                ::close(fd);
+
+                            if(auto data = FileData::open(root / paths[i], m_opts.mmap_threshold)) {
+                                stats.bytes += data->bytes().size();
+                                queue.push({i, std::move(*data)});
+                            }
+                            else ++stats.errors;
+
+                            ++i;
+                            continue;
+                        }
+                    }
+
+                    if(auto buf = acquire(!in_flight)) {
+                        reader.submit(opened.first, 0, opened.second, *buf, i);
+                        reads[i] = std::exchange(opened, {-1, 0});
+                        ++i, ++in_flight;
+                        continue;
+                    }
+                }
+
+                auto done = reader.wait();
+                --in_flight;
+                auto [fd, size] = reads[done.tag];
+                ::close(fd);
+
+                if(done.result == static_cast<ssize_t>(size)) {
+                    stats.bytes += size;
+                    queue.push({static_cast<size_t>(done.tag), {}, done.buf, size});
+                }
+                else ++stats.errors, free_bufs.push(done.buf);
+            }
+
+            queue.finish();
+
+            for(size_t i{};i < leaves.size();++i)
+                if(hashed[i])
+                    m_tree.append_leaf_hash(leaves[i]), ++stats.files;
+
+            stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            return stats;
+        }
+    };
+
+
+    /**
+     * @brief builds a tree over one large file (or stream) split into fixed-size chunks
+     * @details
+     * The calling thread reads the input sequentially into a fixed set of reusable aligned buffers,
+     * workers hash every chunk in place: the leaf salt is written right before the chunk data, so the bytes
+     * go to the hash function without concatenation copies (see TreeBase::prefixed_leaf_hash).
+     * Leaves are appended to the tree in chunk order as soon as all previous chunks are hashed,
+     * so besides the tree itself the memory usage is `buffers · chunk_size` regardless of the input size.
+     * Leaf i is equal to `tree.leaf_hash(chunk i)`, so a chunk can be checked with `tree.get_proof(i)`.
+     * Regular files can also be read through an AsyncReader (io_uring or a pread pool) with many reads in flight.
+     * @tparam Tree tree with `append_leaf_hash`, `leaf_prefix` and `prefixed_leaf_hash` (e.g. AppendOnlyTree),
+     * so its concatenator must not frame byte ranges (see bconcat::plain_byte_ranges)
+     */
+    template<typename Tree>
+    class ChunkedBlobBuilder {
+    public:
+
+        struct Options {
+            size_t chunk_size{size_t{1} << 20}; ///< bytes in one leaf (the last one can be shorter)
+            size_t workers{std::max(1u, std::thread::hardware_concurrency())}; ///< number of hashing threads (tasks on an executor)
+            size_t buffers{}; ///< number of chunk buffers, 0 for 2·workers
+            size_t alignment{4096}; ///< alignment of chunk data in the buffers
+        };
+
+        struct Stats {
+            size_t chunks{}; ///< number of leaves appended to the tree
+            uint64_t bytes{}; ///< total size of the input
+            bool error{}; ///< reading was interrupted by an error, the tree contains only the chunks read before it
+            double seconds{};
+
+            double gbps() const {
+                return seconds > 0? bytes / seconds / 1e9 : 0;
+            }
+        };
+
+    private:
+        using Hash = typename Tree::hash_type;
+
+        Tree& m_tree;
+        Options m_opts;
+        std::optional<ExecutorRef> m_ex{}; ///< shared executor, own threads are started if it is not set
+
+
+        size_t workers() const {
+            return std::max<size_t>(m_opts.workers, 1);
+        }
+
+
+        /**
+         * @brief hashing workers and in-order appending of leaves shared by the readers
+         * @details
+         * Buffers are owned by the reading thread from `acquire` until they are passed to `hash`,
+         * workers return them to the free queue with the leaf, and the leaf is appended to the tree
+         * when the buffer is acquired again (or in `finish`) and all previous chunks are appended
+         */
+        class Pipeline {
+            struct Job {
+                size_t chunk;
+                size_t buf;
+                size_t len;
+            };
+
+            struct Worker {
+                Pipeline* p;
+
+                void operator()(Job& job) const {
+                    auto data = p->m_bufs[job.buf] - p->m_prefix.size();
+                    p->m_hashed[job.buf] = std::make_pair(job.chunk, static_cast<Hash>(
+                        p->m_b.m_tree.prefixed_leaf_hash(std::span<const char>(data, p->m_prefix.size() + job.len))));
+                    p->m_free.push(job.buf);
+                }
+            };
+
+            ChunkedBlobBuilder& m_b;
+            const ReadBuffers& m_bufs;
+            std::vector<char> m_prefix;
+            std::vector<std::optional<std::pair<size_t, Hash>>> m_hashed;    // last result of each buffer
+            std::map<size_t, Hash> m_pending{};   // leaves waiting for previous chunks
+            BoundedQueue<size_t> m_free;
+            ThreadPool m_own;   // hashing threads if the builder has no executor
+            JobQueue<Job, Worker> m_work;
+
+            void collect(const size_t buf) {
+                if(auto& res = m_hashed[buf]) {
+                    m_pending.insert(*res), res.reset();
+                    for(auto it = m_pending.begin();it != m_pending.end() && it->first == appended;it = m_pending.erase(it), ++appended)
+                        m_b.m_tree.append_leaf_hash(it->second);
+                }
+            }
+
+        public:
+            size_t appended{}; ///< number of leaves appended to the tree
+
+            Pipeline(ChunkedBlobBuilder& b, const ReadBuffers& bufs)
+            : m_b{b}, m_bufs{bufs}, m_hashed(bufs.count()), m_free{bufs.count()}, m_own{b.m_ex? 0 : b.workers()},
+              m_work{b.m_ex? *b.m_ex : ExecutorRef(m_own), b.workers(), bufs.count(), Worker{this}} {
+                auto prefix = m_b.m_tree.leaf_prefix();
+                m_prefix.assign(std::begin(prefix), std::end(prefix));
+
+                for(size_t i{};i < bufs.count();++i)
+                    m_free.push(i);
+            }
+
+
+            /**
+             * @return free buffer, or nothing if `wait` is false and all buffers are busy
+             * @details while waiting the calling thread hashes queued chunks itself
+             */
+            std::optional<size_t> acquire(const bool wait) {
+                auto buf = m_free.try_pop();
+                while(!buf && wait && m_work.help())
+                    buf = m_free.try_pop();
+                if(!buf && wait)
+                    buf = m_free.pop();
+
+                if(buf)
+                    collect(*buf);
+
+                return buf;
+            }
+
+            /**
+             * @brief returns an unused buffer
+             */
+            void release(const size_t buf) {
+                m_free.push(buf);
+            }
+
+            /**
+             * @brief passes `len` bytes of the chunk read into the buffer to the workers
+             */
+            void hash(const size_t chunk, const size_t buf, const size_t len) {
+                std::copy(m_prefix.begin(), m_prefix.end(), m_bufs[buf] - m_prefix.size());
+                m_work.push({chunk, buf, len});
+            }
+
+            /**
+             * @brief waits for the workers and appends the remaining leaves
+             */
+            void finish() {
+                m_work.finish();
+                for(size_t i{};i < m_bufs.count();++i)
+                    collect(i);
+            }
+        };
+
+
+        /**
+         * @brief reads up to `n` bytes, fewer only at the end of the input
+         * @return number of bytes read or -1 on error
+         */
+        static ssize_t read_full(int fd, char* dst, size_t n) {
+            size_t done{};
+            while(done < n) {
+                auto r = ::read(fd, dst + done, n - done);
+                if(r < 0 && errno == EINTR)
+                    continue;
+                if(r <= 0)
+                    return r < 0? -1 : static_cast<ssize_t>(done);
+
+                done += r;
+            }
+
+            return static_cast<ssize_t>(done);
+        }
+
+    public:
+
+        explicit ChunkedBlobBuilder(Tree& tree, Options opts = {}) : m_tree{tree}, m_opts{opts} {}
+
+        /**
+         * @param ex executor for the hashing tasks, the reading thread takes part in hashing too
+         */
+        template<Executor E>
+        ChunkedBlobBuilder(Tree& tree, E& ex, Options opts = {}) : m_tree{tree}, m_opts{opts}, m_ex{ExecutorRef(ex)} {}
+
+
+        /**
+         * @brief reads the file from its current position to the end and appends its chunks to the tree
+         * @param fd file descriptor opened for reading, it can also be a pipe or a socket
+         */
+        Stats build(int fd) {
+            auto start = std::chrono::steady_clock::now();
+            Stats stats{};
+
+            ReadBuffers bufs(m_opts.buffers? m_opts.buffers : 2 * workers(), m_opts.chunk_size, m_opts.alignment);
+            Pipeline pipe(*this, bufs);
+
+            for(size_t chunk{};;++chunk) {
+                auto buf = pipe.acquire(true).value();
+                auto len = read_full(fd, bufs[buf], m_opts.chunk_size);
+                if(len <= 0) {
+                    stats.error = len < 0;
+                    break;
+                }
+
+                stats.bytes += len, ++stats.chunks;
+                pipe.hash(chunk, buf, len);
+
+                if(static_cast<size_t>(len) < m_opts.chunk_size)
+                    break;
+            }
+
+            pipe.finish();
+            stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            return stats;
+        }
+
+
+        /**
+         * @brief appends chunks of the file to the tree
+         * @return statistics or nothing if the file can not be opened
+         */
+        std::optional<Stats> build(const std::filesystem::path& path) {
+            int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if(fd < 0)
+                return std::nullopt;
+
+            posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+            auto stats = build(fd);
+            ::close(fd);
+
+            return stats;
+        }
+
+
+        /**
+         * @brief appends chunks of the file to the tree reading them with an asynchronous reader
+         * @details
+         * Chunks are read by offset with up to the number of reader buffers in flight, completed reads
+         * go straight to the hashing workers. The tree is the same as with `build(path)`
+         * @param reader e.g. UringReader or PreadReader, its buffers must fit a chunk
+         * @return statistics or nothing if the file can not be opened or the buffers are too small
+         */
+        template<AsyncReader Reader>
+        std::optional<Stats> build(const std::filesystem::path& path, Reader& reader) {
+            auto start = std::chrono::steady_clock::now();
+            auto&& bufs = reader.buffers();
+            struct stat st{};
+
+            int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if(fd < 0 || fstat(fd, &st) || bufs.buffer_size() < m_opts.chunk_size || bufs.headroom() < std::size(m_tree.leaf_prefix())) {
+                if(fd >= 0)
+                    ::close(fd);
+                return std::nullopt;
+            }
+
+            const uint64_t size = st.st_size;
+            const size_t chunks_n = (size + m_opts.chunk_size - 1) / m_opts.chunk_size;
+            auto chunk_len = [&](uint64_t chunk) {
+                return static_cast<size_t>(std::min<uint64_t>(m_opts.chunk_size, size - chunk * m_opts.chunk_size));
+            };
+
+            Stats stats{};
+            Pipeline pipe(*this, bufs);
+
+            for(size_t next{}, in_flight{};(next < chunks_n && !stats.error) || in_flight;) {
+                if(next < chunks_n && !stats.error)
+                    if(auto buf = pipe.acquire(!in_flight)) {
+                        reader.submit(fd, uint64_t{next} * m_opts.chunk_size, chunk_len(next), *buf, next);
+                        ++next, ++in_flight;
+                        continue;
+                    }
+
+                auto done = reader.wait();
+                --in_flight;
+                if(done.result == static_cast<ssize_t>(chunk_len(done.tag))) {
+                    stats.bytes += done.result;
+                    pipe.hash(done.tag, done.buf, done.result);
+                }
+                else stats.error = true, pipe.release(done.buf);
+            }
+
+            pipe.finish();
+            ::close(fd);
+
+            stats.chunks = pipe.appended;
+            stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            return stats;
+        }
+    };
+
+};
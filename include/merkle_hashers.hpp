@@ -0,0 +1,343 @@
+/**
+ *  @file    merkle_hashers.hpp
+ *  @brief   Reference hash functions usable both at runtime and in constant expressions
+ *  @author  https://github.com/gdaneek
+ *  @date    16.10.2026
+ *  @version 1.1
+ *  @see https://github.com/gdaneek/merkle-tree
+ */
+
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstddef>
+#include <iterator>
+#include <ranges>
+#include <type_traits>
+#include <utility>
+
+#include "bytes_concat.hpp"
+
+namespace merkle {
+
+    /**
+     * @brief SHA-256 (FIPS 180-4)
+     * @details
+     * Plain C++ implementation without intrinsics, so that trees can be built in constant expressions
+     * and have the same roots at compile time and at runtime.
+     * Contiguous inputs are processed block by block without intermediate copies.
+     * @note accepts any iterable container of 1-byte elements (char, unsigned char, std::byte, ...)
+     */
+    class Sha256 {
+
+        static constexpr std::array<uint32_t, 64> K = {
+            0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+            0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+            0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+            0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+            0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+            0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+            0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+            0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+        };
+
+        static constexpr uint32_t rotr(const uint32_t x, const int n) {
+            return (x >> n) | (x << (32 - n));
+        }
+
+        friend class Sha256x8;
+
+    public:
+        using value_type = std::array<uint8_t, 32>;
+
+        /**
+         * @brief incremental hashing state
+         */
+        class State {
+            std::array<uint32_t, 8> m_h = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                           0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+            std::array<uint8_t, 64> m_block{}; ///< incomplete block
+            size_t m_used{}; ///< bytes in the incomplete block
+            uint64_t m_len{}; ///< total length of the input in bytes
+
+
+            template<typename Byte>
+            constexpr void compress(const Byte* p) {
+                std::array<uint32_t, 64> w{};
+                for(size_t i{};i < 16;++i)
+                    w[i] = (uint32_t)(uint8_t)p[i * 4] << 24 | (uint32_t)(uint8_t)p[i * 4 + 1] << 16
+                         | (uint32_t)(uint8_t)p[i * 4 + 2] << 8 | (uint32_t)(uint8_t)p[i * 4 + 3];
+
+                for(size_t i = 16;i < 64;++i) {
+                    auto s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+                    auto s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+                    w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+                }
+
+                auto [a, b, c, d, e, f, g, h] = m_h;
+                for(size_t i{};i < 64;++i) {
+                    auto t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + w[i];
+                    auto t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+                    h = g, g = f, f = e, e = d + t1, d = c, c = b, b = a, a = t1 + t2;
+                }
+
+                m_h[0] += a, m_h[1] += b, m_h[2] += c, m_h[3] += d;
+                m_h[4] += e, m_h[5] += f, m_h[6] += g, m_h[7] += h;
+            }
+
+        public:
+
+            /**
+             * @brief feeds `n` bytes starting from `p`
+             */
+            template<typename Byte> requires (sizeof(Byte) == 1)
+            constexpr State& update(const Byte* p, size_t n) {
+                m_len += n;
+                for(;n && m_used;--n) {
+                    m_block[m_used++] = (uint8_t)*p++;
+                    if(m_used == 64)
+                        compress(m_block.data()), m_used = 0;
+                }
+
+                for(;n >= 64;n -= 64, p += 64)
+                    compress(p);
+
+                for(;n;--n)
+                    m_block[m_used++] = (uint8_t)*p++;
+
+                return *this;
+            }
+
+
+            /**
+             * @brief feeds all bytes of a container
+             */
+            template<typename T> requires std::ranges::input_range<T>
+            constexpr State& update(T&& bytes) {
+                if constexpr (bconcat::Segmented<std::remove_cvref_t<T>>) {
+                    for(size_t i{};i < bytes.segments();++i)
+                        update(bytes.segment(i).data(), bytes.segment(i).size());
+
+                    return *this;
+                }
+                else if constexpr (std::ranges::contiguous_range<T>)
+                    return update(std::ranges::data(bytes), std::ranges::size(bytes));
+                else {
+                    for(auto&& x : bytes) {
+                        const uint8_t b = static_cast<uint8_t>(x);
+                        update(&b, 1);
+                    }
+
+                    return *this;
+                }
+            }
+
+
+            /**
+             * @brief finishes the calculation
+             * @return digest of all fed bytes
+             */
+            constexpr value_type finish() {
+                const uint64_t bits = m_len << 3;
+                const uint8_t pad[72] = {0x80};
+                update(pad, 1 + ((119 - (m_len & 63)) & 63));
+
+                std::array<uint8_t, 8> len{};
+                for(size_t i{};i < 8;++i)
+                    len[i] = static_cast<uint8_t>(bits >> (56 - 8 * i));
+                update(len.data(), len.size());
+
+                value_type digest{};
+                for(size_t i{};i < 32;++i)
+                    digest[i] = static_cast<uint8_t>(m_h[i >> 2] >> (24 - 8 * (i & 3)));
+
+                return digest;
+            }
+        };
+
+
+        constexpr value_type operator()(auto&& cont) const {
+            return State{}.update(std::forward<decltype(cont)>(cont)).finish();
+        }
+    };
+
+
+    /**
+     * @brief multi-buffer SHA-256 compressing 8 independent messages at once
+     * @details
+     * Word `i` of all 8 messages (and of all 8 states) is stored together, so every step of the
+     * compression is the same operation on 8 lanes; the loops over lanes are written to be vectorized
+     * by the compiler (e.g. into one AVX2 register). Words are the big-endian words of the message,
+     * and a digest word `i` is bytes `4i..4i+3` of the digest.
+     */
+    class Sha256x8 {
+    public:
+        static constexpr size_t lanes = 8;
+
+        using Words = std::array<uint32_t, lanes>; ///< one word of every lane
+        using Digest = std::array<Words, 8>;
+        using Block = std::array<Words, 16>;
+
+        static constexpr Digest init() {
+            constexpr std::array<uint32_t, 8> iv = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                                    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+            Digest h{};
+            for(size_t i{};i < 8;++i)
+                h[i].fill(iv[i]);
+
+            return h;
+        }
+
+
+        /**
+         * @brief processes one 64-byte block of every lane
+         */
+        static constexpr void compress(Digest& h, const Block& block) {
+            std::array<Words, 64> w{};
+            for(size_t t{};t < 16;++t)
+                w[t] = block[t];
+
+            for(size_t t = 16;t < 64;++t)
+                for(size_t l{};l < lanes;++l) {
+                    const uint32_t s0 = Sha256::rotr(w[t - 15][l], 7) ^ Sha256::rotr(w[t - 15][l], 18) ^ (w[t - 15][l] >> 3);
+                    const uint32_t s1 = Sha256::rotr(w[t - 2][l], 17) ^ Sha256::rotr(w[t - 2][l], 19) ^ (w[t - 2][l] >> 10);
+                    w[t][l] = w[t - 16][l] + s0 + w[t - 7][l] + s1;
+                }
+
+            auto [a, b, c, d, e, f, g, hh] = h;
+            for(size_t t{};t < 64;++t) {
+                Words t1{}, t2{};
+                for(size_t l{};l < lanes;++l) {
+                    const uint32_t s1 = Sha256::rotr(e[l], 6) ^ Sha256::rotr(e[l], 11) ^ Sha256::rotr(e[l], 25);
+                    const uint32_t ch = (e[l] & f[l]) ^ (~e[l] & g[l]);
+                    t1[l] = hh[l] + s1 + ch + Sha256::K[t] + w[t][l];
+                    const uint32_t s0 = Sha256::rotr(a[l], 2) ^ Sha256::rotr(a[l], 13) ^ Sha256::rotr(a[l], 22);
+                    t2[l] = s0 + ((a[l] & b[l]) ^ (a[l] & c[l]) ^ (b[l] & c[l]));
+                }
+
+                hh = g, g = f, f = e;
+                for(size_t l{};l < lanes;++l)
+                    e[l] = d[l] + t1[l];
+                d = c, c = b, b = a;
+                for(size_t l{};l < lanes;++l)
+                    a[l] = t1[l] + t2[l];
+            }
+
+            const Digest v = {a, b, c, d, e, f, g, hh};
+            for(size_t i{};i < 8;++i)
+                for(size_t l{};l < lanes;++l)
+                    h[i][l] += v[i][l];
+        }
+    };
+
+
+    /**
+     * @brief requires a hasher with an incremental state fed by (pointer, length) pieces, like Sha256::State
+     * @details Such a hasher consumes a segment list (bconcat::SegmentConcatenator) without gathering it
+     */
+    template<typename H>
+    concept SegmentHasher = requires { typename H::State; } && requires(typename H::State st, const char* p, size_t n) {
+        st.update(p, n);
+        { st.finish() } -> std::convertible_to<typename H::value_type>;
+    };
+
+
+    /**
+     * @brief hashes a segment list segment by segment, the result equals the hash of the concatenated bytes
+     */
+    template<SegmentHasher H, bconcat::Segmented S>
+    constexpr auto hash_segments(const H&, const S& segs) {
+        typename H::State st{};
+        for(size_t i{};i < segs.segments();++i)
+            st.update(segs.segment(i).data(), segs.segment(i).size());
+
+        return st.finish();
+    }
+
+
+    /**
+     * @brief hasher storing only the first `BYTES` bytes of the output of `Hasher`
+     * @details
+     * Using it as the tree hasher makes nodes `BYTES` long: the tree takes 2-4 times less memory
+     * and twice as many nodes fit into a cache line. Parent hashes are calculated from the truncated
+     * children, so proofs carry truncated hashes and verify against the truncated root.
+     * Collision resistance drops to `4 * BYTES` bits.
+     * @warning meant for integrity checks of trusted data, not for authenticating untrusted input
+     */
+    template<typename Hasher, size_t BYTES>
+    class Truncated {
+        using full_type = typename Hasher::value_type;
+
+        static_assert(BYTES > 0 && BYTES <= sizeof(full_type), "truncation width must not exceed the digest size");
+
+        [[no_unique_address]] Hasher m_hash{};
+
+    public:
+        using value_type = std::array<uint8_t, BYTES>;
+
+        static constexpr value_type truncate(const full_type& digest) {
+            auto bytes = std::bit_cast<std::array<uint8_t, sizeof(full_type)>>(digest);
+            value_type res{};
+            for(size_t i{};i < BYTES;++i)
+                res[i] = bytes[i];
+
+            return res;
+        }
+
+
+        /**
+         * @brief incremental state, available if `Hasher` has one
+         */
+        template<typename H = Hasher> requires SegmentHasher<H>
+        class StateOf {
+            typename H::State m_state{};
+
+        public:
+            template<typename... Args>
+            constexpr StateOf& update(Args&&... args) {
+                m_state.update(std::forward<Args>(args)...);
+                return *this;
+            }
+
+            constexpr value_type finish() {
+                return truncate(m_state.finish());
+            }
+        };
+
+        using State = decltype([] {
+            if constexpr (SegmentHasher<Hasher>)
+                return std::type_identity<StateOf<>>{};
+            else return std::type_identity<void>{};
+        }())::type;
+
+
+        constexpr Truncated() = default;
+
+        constexpr explicit Truncated(Hasher hash) : m_hash{std::move(hash)} {}
+
+
+        constexpr value_type operator()(auto&& cont) const {
+            return truncate(m_hash(std::forward<decltype(cont)>(cont)));
+        }
+    };
+
+
+    /**
+     * @brief 64-bit FNV-1a
+     * @warning not a cryptographic hash, useful for tests, benchmarks and integrity checks of trusted data
+     */
+    struct Fnv1a {
+        using value_type = uint64_t;
+
+        constexpr value_type operator()(auto&& cont) const {
+            uint64_t hash{0xcbf29ce484222325};
+            for(auto&& x : cont)
+                hash = (hash ^ static_cast<uint8_t>(x)) * 0x100000001b3;
+
+            return hash;
+        }
+    };
+
+};
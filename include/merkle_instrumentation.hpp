@@ -0,0 +1,152 @@
+/**
+ *  @file    merkle_instrumentation.hpp
+ *  @brief   Policies for counting hash calls, hashed bytes, allocations and build time of the trees
+ *  @author  https://github.com/gdaneek
+ *  @date    16.10.2026
+ *  @version 1.1
+ *  @see https://github.com/gdaneek/merkle-tree
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+
+namespace merkle {
+
+    /**
+     * @brief snapshot of the instrumentation counters
+     */
+    struct InstrumentationStats {
+        static constexpr size_t max_layers = 64;
+
+        uint64_t leaf_hashes{}; ///< number of leaf_hash calls
+        uint64_t node_hashes{}; ///< number of node_hash calls
+        uint64_t hashed_bytes{}; ///< bytes passed to the hash function
+        uint64_t concat_allocs{}; ///< concatenations whose result owns heap memory
+        std::array<uint64_t, max_layers> layer_ns{}; ///< build time of each layer in nanoseconds, 0 for the leaves
+
+        constexpr uint64_t hashes() const {
+            return leaf_hashes + node_hashes;
+        }
+
+        /**
+         * @brief difference of two snapshots, e.g. the cost of one operation
+         */
+        constexpr InstrumentationStats operator-(const InstrumentationStats& rhs) const {
+            InstrumentationStats d{leaf_hashes - rhs.leaf_hashes, node_hashes - rhs.node_hashes,
+                                   hashed_bytes - rhs.hashed_bytes, concat_allocs - rhs.concat_allocs};
+            for(size_t i{};i < max_layers;++i)
+                d.layer_ns[i] = layer_ns[i] - rhs.layer_ns[i];
+
+            return d;
+        }
+    };
+
+
+    /**
+     * @brief default policy, all hooks are empty and are removed by the compiler
+     */
+    struct NoInstrumentation {
+        struct LayerTimer {};
+
+        static constexpr void on_leaf_hash(const auto&) {}
+        static constexpr void on_node_hash(const auto&) {}
+        static constexpr LayerTimer layer_begin() { return {}; }
+        static constexpr void layer_end(size_t, LayerTimer) {}
+
+        static constexpr InstrumentationStats snapshot() { return {}; }
+        static constexpr void reset() {}
+    };
+
+
+    /**
+     * @brief policy counting hash calls, hashed bytes, allocating concatenations and build time per layer
+     * @details
+     * Counters are relaxed atomics, so one tree can be instrumented while it is hashed from several threads.
+     * Hooks are skipped in constant evaluation
+     */
+    class CountingInstrumentation {
+        std::atomic<uint64_t> m_leaf_hashes{}, m_node_hashes{}, m_hashed_bytes{}, m_concat_allocs{};
+        std::array<std::atomic<uint64_t>, InstrumentationStats::max_layers> m_layer_ns{};
+
+
+        void on_concat(const auto& bytes) {
+            using T = std::remove_cvref_t<decltype(bytes)>;
+            if constexpr (requires { std::size(bytes); })
+                m_hashed_bytes.fetch_add(std::size(bytes) * sizeof(*std::begin(bytes)), std::memory_order_relaxed);
+            else m_hashed_bytes.fetch_add(sizeof(T), std::memory_order_relaxed);
+
+            if constexpr (requires { bytes.capacity(); })
+                m_concat_allocs.fetch_add(bytes.capacity() != 0, std::memory_order_relaxed);
+        }
+
+    public:
+        using LayerTimer = std::chrono::steady_clock::time_point;
+
+        CountingInstrumentation() = default;
+
+        CountingInstrumentation(const CountingInstrumentation& other) {
+            *this = other;
+        }
+
+        CountingInstrumentation& operator=(const CountingInstrumentation& other) {
+            auto s = other.snapshot();
+            m_leaf_hashes = s.leaf_hashes, m_node_hashes = s.node_hashes;
+            m_hashed_bytes = s.hashed_bytes, m_concat_allocs = s.concat_allocs;
+            for(size_t i{};i < s.layer_ns.size();++i)
+                m_layer_ns[i] = s.layer_ns[i];
+
+            return *this;
+        }
+
+
+        /**
+         * @param bytes concatenated input passed to the hash function
+         */
+        constexpr void on_leaf_hash(const auto& bytes) {
+            if(!std::is_constant_evaluated())
+                m_leaf_hashes.fetch_add(1, std::memory_order_relaxed), on_concat(bytes);
+        }
+
+        constexpr void on_node_hash(const auto& bytes) {
+            if(!std::is_constant_evaluated())
+                m_node_hashes.fetch_add(1, std::memory_order_relaxed), on_concat(bytes);
+        }
+
+
+        constexpr LayerTimer layer_begin() const {
+            return std::is_constant_evaluated()? LayerTimer{} : std::chrono::steady_clock::now();
+        }
+
+        /**
+         * @param layer layer index counted from the leaves
+         */
+        constexpr void layer_end(const size_t layer, const LayerTimer start) {
+            if(!std::is_constant_evaluated() && layer < m_layer_ns.size())
+                m_layer_ns[layer].fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - start).count(), std::memory_order_relaxed);
+        }
+
+
+        InstrumentationStats snapshot() const {
+            InstrumentationStats s{m_leaf_hashes.load(std::memory_order_relaxed), m_node_hashes.load(std::memory_order_relaxed),
+                                   m_hashed_bytes.load(std::memory_order_relaxed), m_concat_allocs.load(std::memory_order_relaxed)};
+            for(size_t i{};i < s.layer_ns.size();++i)
+                s.layer_ns[i] = m_layer_ns[i].load(std::memory_order_relaxed);
+
+            return s;
+        }
+
+
+        void reset() {
+            *this = CountingInstrumentation{};
+        }
+    };
+
+};
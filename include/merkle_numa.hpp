@@ -0,0 +1,262 @@
+/**
+ *  @file    merkle_numa.hpp
+ *  @brief   NUMA topology, per-node thread pools and the partitioned tree build
+ *  @author  https://github.com/gdaneek
+ *  @date    16.10.2026
+ *  @version 1.1
+ *  @see https://github.com/gdaneek/merkle-tree
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstddef>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <latch>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "merkle_parallel.hpp"
+
+#if defined(__linux__)
+#define MERKLE_HAS_AFFINITY 1
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace merkle {
+
+    /**
+     * @brief CPUs of every NUMA node available to the process
+     */
+    struct NumaTopology {
+        std::vector<std::vector<int>> nodes{}; ///< CPU numbers of every node, no node is empty
+
+        /**
+         * @brief parses a CPU list in the sysfs format, e.g. "0-3,8,10-11"
+         */
+        static std::vector<int> parse_cpulist(std::string_view list) {
+            std::vector<int> cpus{};
+            while(!list.empty()) {
+                auto item = list.substr(0, list.find(','));
+                list.remove_prefix(std::min(list.size(), item.size() + 1));
+
+                int first{-1}, last{-1};
+                auto dash = item.find('-');
+                std::from_chars(item.data(), item.data() + std::min(dash, item.size()), first);
+                if(dash == std::string_view::npos)
+                    last = first;
+                else std::from_chars(item.data() + dash + 1, item.data() + item.size(), last);
+
+                for(int cpu = first;first >= 0 && cpu <= last;++cpu)
+                    cpus.push_back(cpu);
+            }
+
+            return cpus;
+        }
+
+
+        /**
+         * @return CPUs the calling thread may run on
+         */
+        static std::vector<int> available_cpus() {
+            std::vector<int> cpus{};
+#ifdef MERKLE_HAS_AFFINITY
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            if(!sched_getaffinity(0, sizeof(set), &set))
+                for(int cpu{};cpu < CPU_SETSIZE;++cpu)
+                    if(CPU_ISSET(cpu, &set))
+                        cpus.push_back(cpu);
+#endif
+            if(cpus.empty())
+                for(int cpu{};cpu < static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));++cpu)
+                    cpus.push_back(cpu);
+
+            return cpus;
+        }
+
+
+        /**
+         * @brief reads the topology from /sys/devices/system/node, a single node if it is not available
+         */
+        static NumaTopology detect() {
+            const auto cpus = available_cpus();
+            std::vector<std::pair<int, std::vector<int>>> found{};
+
+            std::error_code ec;
+            for(auto& entry : std::filesystem::directory_iterator("/sys/devices/system/node", ec)) {
+                const auto name = entry.path().filename().string();
+                if(name.size() <= 4 || name.compare(0, 4, "node") || !std::all_of(name.begin() + 4, name.end(), ::isdigit))
+                    continue;
+
+                std::ifstream in(entry.path() / "cpulist");
+                std::string list{};
+                std::getline(in, list);
+
+                std::vector<int> node{};
+                for(int cpu : parse_cpulist(list))
+                    if(std::binary_search(cpus.begin(), cpus.end(), cpu))
+                        node.push_back(cpu);
+                if(!node.empty())
+                    found.emplace_back(std::stoi(name.substr(4)), std::move(node));
+            }
+
+            NumaTopology topo{};
+            std::sort(found.begin(), found.end());
+            for(auto& [id, node] : found)
+                topo.nodes.push_back(std::move(node));
+            if(topo.nodes.empty())
+                topo.nodes.push_back(cpus);
+
+            return topo;
+        }
+
+
+        /**
+         * @brief splits the available CPUs into `n` nodes, to test NUMA code paths on any machine
+         * @details If there are fewer CPUs than nodes, the nodes share them
+         */
+        static NumaTopology simulated(const size_t n) {
+            const auto cpus = available_cpus();
+            const size_t m = std::max<size_t>(n, 1);
+            NumaTopology topo{};
+            for(size_t i{};i < m;++i) {
+                const size_t first = cpus.size() * i / m, last = std::max(cpus.size() * (i + 1) / m, first + 1);
+                std::vector<int> node{};
+                for(size_t c = first;c < last;++c)
+                    node.push_back(cpus[c % cpus.size()]);
+                topo.nodes.push_back(std::move(node));
+            }
+
+            return topo;
+        }
+
+
+        size_t size() const {
+            return nodes.size();
+        }
+    };
+
+
+    /**
+     * @brief restricts the calling thread to the given CPUs
+     * @return false if it is not supported or not permitted
+     */
+    inline bool pin_thread(const std::vector<int>& cpus) {
+#ifdef MERKLE_HAS_AFFINITY
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for(int cpu : cpus)
+            if(cpu >= 0 && cpu < CPU_SETSIZE)
+                CPU_SET(cpu, &set);
+
+        return !pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+        (void)cpus;
+        return false;
+#endif
+    }
+
+
+    /**
+     * @brief thread pool for every NUMA node, its threads are pinned to the CPUs of the node
+     * @details
+     * Memory written first by a thread of a node is placed on that node by the OS (first-touch policy),
+     * so work split by nodes keeps the data next to the threads using it
+     */
+    class NumaPools {
+        NumaTopology m_topo;
+        std::vector<std::unique_ptr<ThreadPool>> m_pools{};
+
+    public:
+
+        /**
+         * @param threads_per_node number of threads of every pool, 0 for the number of CPUs of the node
+         */
+        explicit NumaPools(NumaTopology topo = NumaTopology::detect(), const size_t threads_per_node = 0) : m_topo{std::move(topo)} {
+            for(auto& cpus : m_topo.nodes)
+                m_pools.push_back(std::make_unique<ThreadPool>(threads_per_node? threads_per_node : cpus.size(),
+                                                               [cpus] { pin_thread(cpus); }));
+        }
+
+
+        size_t nodes() const {
+            return m_pools.size();
+        }
+
+
+        const NumaTopology& topology() const {
+            return m_topo;
+        }
+
+
+        /**
+         * @return pool of the node, its threads run on the CPUs of the node
+         */
+        ThreadPool& executor(const size_t node) {
+            return *m_pools[node];
+        }
+    };
+
+
+    /**
+     * @brief builds the tree with the work split between NUMA nodes
+     * @details
+     * Leaves are split into blocks like in `build_parallel`, and every node gets a contiguous run of blocks,
+     * which it builds on its own pool with work stealing. The part of every layer below the subtree roots
+     * is then a contiguous slice written only by the threads of one node. Only the small layers above
+     * the subtrees are built by the calling thread. The result is identical to `tree.build`
+     * @param tree e.g. FixedSizeTree
+     * @param numa per-node pools, e.g. `NumaPools{}` for the detected topology
+     * @param opts `workers` limits the threads of every node
+     * @return the tree; an exception thrown on a node is rethrown after all nodes are finished
+     * @note The OS places a page on the node that touches it first, so the slices are local to their nodes
+     * only if the memory of the tree was never written before this call. Pages touched earlier (by a previous
+     * build, zero-initialization or a copy) stay where they are, and only the hashing work is split by nodes
+     * @warning must not be called on a thread of `numa`, the calling thread waits for the nodes
+     */
+    template<typename Tree, std::ranges::random_access_range Container>
+    auto& build_numa(Tree& tree, Container&& ccont, NumaPools& numa, const ParallelOptions opts = {}) {
+        const auto [sub, blocks] = detail::subtree_blocks<Tree>(opts);
+        const size_t nodes = numa.nodes();
+        if(nodes < 2 || blocks < nodes)
+            return build_parallel(tree, std::forward<Container>(ccont), numa.executor(0), opts);
+
+        auto leaves = std::ranges::begin(ccont);
+        std::latch done(static_cast<std::ptrdiff_t>(nodes));
+        std::mutex error_mtx;
+        std::exception_ptr error{};
+        for(size_t n{};n < nodes;++n)
+            numa.executor(n).execute([&, n] {
+                try {
+                    const size_t first = blocks * n / nodes, last = blocks * (n + 1) / nodes;
+                    work_stealing_for(numa.executor(n), last - first, [&](const size_t b) { tree.build_subtree(leaves, first + b, sub); }, opts.workers);
+                }
+                catch(...) {
+                    std::lock_guard lock(error_mtx);
+                    if(!error)
+                        error = std::current_exception();
+                }
+
+                done.count_down();
+            });
+
+        done.wait();
+        if(error)
+            std::rethrow_exception(error);
+
+        tree.build_top(leaves, blocks * sub, sub);
+
+        return tree;
+    }
+
+};
@@ -0,0 +1,433 @@
+/**
+ *  @file    merkle_parallel.hpp
+ *  @brief   Executors, the work-stealing scheduler and the parallel tree operations built on them
+ *  @author  https://github.com/gdaneek
+ *  @date    16.10.2026
+ *  @version 1.1
+ *  @see https://github.com/gdaneek/merkle-tree
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <concepts>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ranges>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace merkle {
+
+    /**
+     * @brief requires something running `void()` tasks, e.g. a thread pool
+     * @details
+     * `concurrency()` is the number of threads running the tasks besides the caller. The library never blocks
+     * a task on another one and the calling thread always takes part in the work, so a busy shared pool
+     * only slows an operation down. `execute` may run the task inline only if `concurrency()` is 0
+     */
+    template<typename E>
+    concept Executor = requires(E& e, std::function<void()> f) {
+        e.execute(std::move(f));
+        { e.concurrency() } -> std::convertible_to<size_t>;
+    };
+
+
+    /**
+     * @brief executor without threads, all the work is done by the calling thread
+     */
+    struct InlineExecutor {
+        static void execute(std::function<void()> f) {
+            f();
+        }
+
+        static constexpr size_t concurrency() {
+            return 0;
+        }
+    };
+
+
+    /**
+     * @brief fixed set of threads taking tasks from a shared FIFO queue
+     * @details
+     * `init` is called by every thread before it takes tasks (e.g. to pin it to CPUs).
+     * The destructor runs the queued tasks and joins the threads
+     */
+    class ThreadPool {
+        std::mutex m_mtx;
+        std::condition_variable m_cv;
+        std::deque<std::function<void()>> m_tasks{};
+        bool m_stop{};
+        std::vector<std::thread> m_threads{};
+
+    public:
+
+        explicit ThreadPool(const size_t threads = std::thread::hardware_concurrency(), std::function<void()> init = {}) {
+            for(size_t i{};i < threads;++i)
+                m_threads.emplace_back([this, init] {
+                    if(init)
+                        init();
+
+                    for(;;) {
+                        std::unique_lock lock(m_mtx);
+                        m_cv.wait(lock, [this] { return m_stop || !m_tasks.empty(); });
+                        if(m_tasks.empty())
+                            return;
+
+                        auto task = std::move(m_tasks.front());
+                        m_tasks.pop_front();
+                        lock.unlock();
+                        task();
+                    }
+                });
+        }
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        ~ThreadPool() {
+            {
+                std::lock_guard lock(m_mtx);
+                m_stop = true;
+            }
+            m_cv.notify_all();
+            for(auto&& t : m_threads)
+                t.join();
+        }
+
+
+        void execute(std::function<void()> f) {
+            {
+                std::lock_guard lock(m_mtx);
+                m_tasks.push_back(std::move(f));
+            }
+            m_cv.notify_one();
+        }
+
+
+        size_t concurrency() const {
+            return m_threads.size();
+        }
+    };
+
+
+    /**
+     * @brief executor over a user thread pool
+     * @details
+     * Example: `ExecutorAdapter ex([&](auto task) { pool.post(std::move(task)); }, pool.size());`
+     * @tparam Submit callable taking std::function<void()> and scheduling it on the pool
+     */
+    template<typename Submit>
+    class ExecutorAdapter {
+        Submit m_submit;
+        size_t m_concurrency;
+
+    public:
+
+        ExecutorAdapter(Submit submit, const size_t concurrency) : m_submit{std::move(submit)}, m_concurrency{concurrency} {}
+
+
+        void execute(std::function<void()> f) {
+            m_submit(std::move(f));
+        }
+
+
+        size_t concurrency() const {
+            return m_concurrency;
+        }
+    };
+
+
+    /**
+     * @brief non-owning type-erased reference to an executor, lets classes store any executor
+     */
+    class ExecutorRef {
+        void* m_ex;
+        void (*m_execute)(void*, std::function<void()>);
+        size_t (*m_concurrency)(const void*);
+
+    public:
+
+        template<Executor E> requires (!std::same_as<E, ExecutorRef>)
+        ExecutorRef(E& ex)
+        : m_ex{&ex},
+          m_execute{[](void* e, std::function<void()> f) { static_cast<E*>(e)->execute(std::move(f)); }},
+          m_concurrency{[](const void* e) -> size_t { return static_cast<const E*>(e)->concurrency(); }} {}
+
+
+        void execute(std::function<void()> f) const {
+            m_execute(m_ex, std::move(f));
+        }
+
+
+        size_t concurrency() const {
+            return m_concurrency(m_ex);
+        }
+    };
+
+
+    /**
+     * @brief runs tasks on an executor and waits for them, tasks not started before `wait` are skipped
+     * @details
+     * Skipping makes waiting safe when the executor is busy (or is the thread calling `wait`):
+     * the caller is expected to finish the work itself, and tasks only help it
+     */
+    class TaskGroup {
+        struct State {
+            std::mutex mtx;
+            std::condition_variable cv;
+            size_t active{};
+            bool closed{};
+        };
+
+        std::shared_ptr<State> m_state{std::make_shared<State>()};
+
+    public:
+
+        TaskGroup() = default;
+        TaskGroup(const TaskGroup&) = delete;
+        TaskGroup& operator=(const TaskGroup&) = delete;
+
+        ~TaskGroup() {
+            wait();
+        }
+
+
+        template<Executor E, typename F>
+        void spawn(E& ex, F f) {
+            ex.execute([state = m_state, f = std::move(f)]() mutable {
+                {
+                    std::lock_guard lock(state->mtx);
+                    if(state->closed)
+                        return;
+                    ++state->active;
+                }
+
+                f();
+
+                std::lock_guard lock(state->mtx);
+                --state->active;
+                state->cv.notify_all();
+            });
+        }
+
+
+        /**
+         * @brief waits for the started tasks and cancels the others
+         */
+        void wait() {
+            std::unique_lock lock(m_state->mtx);
+            m_state->closed = true;
+            m_state->cv.wait(lock, [this] { return !m_state->active; });
+        }
+    };
+
+    /**
+     * @brief settings of the subtree-granular parallel build
+     */
+    struct ParallelOptions {
+        size_t workers{std::max(1u, std::thread::hardware_concurrency())}; ///< number of threads including the calling one
+        size_t subtree_leaves{}; ///< leaves in one task, rounded down to a power of two, 0 for a subtree fitting into L2
+
+        /**
+         * @return leaves in one task for hashes of the given size
+         * @details By default a subtree with all its layers takes about 256 KiB
+         */
+        constexpr size_t subtree_size(const size_t hash_size) const {
+            return std::bit_floor(std::max<size_t>(subtree_leaves? subtree_leaves : (size_t{1} << 17) / std::max<size_t>(hash_size, 1), 2));
+        }
+    };
+
+
+    /**
+     * @brief calls `f(i)` for all i in [0, n) on the calling thread and the executor, balancing the load by work stealing
+     * @details
+     * Every worker owns a contiguous range of indices and takes them from the front. A worker whose range
+     * is empty steals the back half of the largest range left at another worker, so neighbouring tasks
+     * stay on one core and there is no shared counter contended on every task.
+     * The calling thread is one of the workers; the call returns when all tasks are done.
+     * @param workers max number of workers including the calling thread
+     */
+    template<Executor E, typename F>
+    void work_stealing_for(E& ex, const size_t n, F&& f, const size_t workers = ~size_t{0}) {
+        const size_t workers_n = std::min({ex.concurrency() + 1, std::max<size_t>(workers, 1), n});
+        if(workers_n <= 1) {
+            for(size_t i{};i < n;++i)
+                f(i);
+            return;
+        }
+
+        struct alignas(64) Range {
+            std::mutex mtx;
+            size_t begin, end;
+        };
+
+        auto ranges = std::make_unique<Range[]>(workers_n);
+        for(size_t w{};w < workers_n;++w)
+            ranges[w].begin = n * w / workers_n, ranges[w].end = n * (w + 1) / workers_n;
+
+        auto take = [&](const size_t w, size_t& task) {
+            for(;;) {
+                {
+                    std::lock_guard lock(ranges[w].mtx);
+                    if(ranges[w].begin < ranges[w].end) {
+                        task = ranges[w].begin++;
+                        return true;
+                    }
+                }
+
+                size_t victim{w}, most{};
+                for(size_t v{};v < workers_n;++v) {
+                    std::lock_guard lock(ranges[v].mtx);
+                    if(ranges[v].end - ranges[v].begin > most)
+                        most = ranges[v].end - ranges[v].begin, victim = v;
+                }
+                if(!most)
+                    return false;
+
+                size_t begin{}, end{};
+                {
+                    std::lock_guard lock(ranges[victim].mtx);
+                    auto& r = ranges[victim];
+                    if(r.begin == r.end)
+                        continue;   // stolen by somebody else meanwhile
+
+                    begin = r.begin + ((r.end - r.begin) >> 1), end = r.end;
+                    r.end = begin;
+                }
+
+                std::lock_guard lock(ranges[w].mtx);
+                ranges[w].begin = begin + 1, ranges[w].end = end;
+                task = begin;
+                return true;
+            }
+        };
+
+        auto run = [&](const size_t w) {
+            for(size_t task{};take(w, task);)
+                f(task);
+        };
+
+        TaskGroup group{};
+        for(size_t w = 1;w < workers_n;++w)
+            group.spawn(ex, [&run, w] { run(w); });
+
+        run(0);
+        group.wait();
+    }
+
+
+    /**
+     * @brief work_stealing_for on `workers - 1` new threads and the calling one
+     */
+    template<typename F>
+    void work_stealing_for(const size_t n, const size_t workers, F&& f) {
+        ThreadPool pool(std::min(workers, n) - (std::min(workers, n) > 0));
+        work_stealing_for(pool, n, std::forward<F>(f));
+    }
+
+
+    namespace detail {
+
+        /**
+         * @return leaves in one block of the subtree-granular build and the number of full blocks
+         * (0 for a tree of one leaf, which is never split)
+         */
+        template<typename Tree>
+        constexpr std::pair<size_t, size_t> subtree_blocks(const ParallelOptions& opts) {
+            constexpr size_t leafs_n = Tree::get_leafs_n();
+            const size_t sub = std::min<size_t>(opts.subtree_size(sizeof(typename Tree::hash_type)), std::bit_floor(leafs_n));
+            return {sub, leafs_n > 1? leafs_n / sub : 0};
+        }
+
+    }
+
+
+    /**
+     * @brief builds the tree on several threads, subtree by subtree
+     * @details
+     * Leaves are split into blocks of `opts.subtree_size` leaves, and every worker builds a whole subtree
+     * of a block up to its root (Tree::build_subtree), so the working set stays in the core's cache and there
+     * is no barrier between layers. Blocks are scheduled with work stealing (see work_stealing_for).
+     * The leaves after the last full block and the layers above the subtrees are built on the calling thread.
+     * The result (including `get_layer`) is identical to `tree.build`
+     * @param tree e.g. FixedSizeTree
+     * @param ccont random access container with LEAFS_N elements
+     * @param ex executor running the subtrees together with the calling thread
+     * @param opts `workers` limits the number of threads including the calling one
+     * @warning the hasher and the concatenator are called concurrently and must not have a mutable state
+     */
+    template<typename Tree, std::ranges::random_access_range Container, Executor E>
+    auto& build_parallel(Tree& tree, Container&& ccont, E& ex, const ParallelOptions opts = {}) {
+        const auto [sub, blocks] = detail::subtree_blocks<Tree>(opts);
+        if(blocks < 2 || opts.workers < 2 || !ex.concurrency())
+            return tree.build(std::forward<Container>(ccont));
+
+        auto leaves = std::ranges::begin(ccont);
+        work_stealing_for(ex, blocks, [&](const size_t b) { tree.build_subtree(leaves, b, sub); }, opts.workers);
+        tree.build_top(leaves, blocks * sub, sub);
+
+        return tree;
+    }
+
+
+    /**
+     * @brief build_parallel on up to `opts.workers - 1` new threads and the calling one
+     * @details Trees too small to be split are built serially without starting any thread
+     */
+    template<typename Tree, std::ranges::random_access_range Container>
+    auto& build_parallel(Tree& tree, Container&& ccont, const ParallelOptions opts = {}) {
+        const size_t blocks = detail::subtree_blocks<Tree>(opts).second;
+        if(blocks < 2 || opts.workers < 2)
+            return tree.build(std::forward<Container>(ccont));
+
+        ThreadPool pool(std::min(opts.workers, blocks) - 1);
+        return build_parallel(tree, std::forward<Container>(ccont), pool, opts);
+    }
+
+
+    /**
+     * @brief creates proofs of inclusion of many inputs at once
+     * @param data random access range of inputs
+     * @param ex executor sharing the work with the calling thread
+     * @return proofs in the order of the inputs, as returned by `tree.get_proof`
+     */
+    template<typename Tree, std::ranges::random_access_range R, Executor E>
+    auto get_proofs(const Tree& tree, const R& data, E& ex) {
+        constexpr size_t batch = 64;
+        const size_t n = std::ranges::size(data);
+        std::vector<decltype(tree.get_proof(*std::ranges::begin(data)))> proofs(n);
+        work_stealing_for(ex, (n + batch - 1) / batch, [&](const size_t b) {
+            for(size_t i = b * batch;i < std::min(n, (b + 1) * batch);++i)
+                proofs[i] = tree.get_proof(std::ranges::begin(data)[i]);
+        });
+
+        return proofs;
+    }
+
+
+    /**
+     * @brief checks proofs of inclusion of many inputs at once
+     * @param proofs proofs in the order of the inputs, as returned by `tree.get_proof` (the second element)
+     * @return result of `tree.verify_proof` for every input (1 or 0)
+     */
+    template<typename Tree, std::ranges::random_access_range R, std::ranges::random_access_range P, Executor E>
+    std::vector<char> verify_proofs(const Tree& tree, const R& data, const P& proofs, E& ex) {
+        constexpr size_t batch = 64;
+        const size_t n = std::min<size_t>(std::ranges::size(data), std::ranges::size(proofs));
+        std::vector<char> res(n);
+        work_stealing_for(ex, (n + batch - 1) / batch, [&](const size_t b) {
+            for(size_t i = b * batch;i < std::min(n, (b + 1) * batch);++i)
+                res[i] = tree.verify_proof(std::ranges::begin(data)[i], std::ranges::begin(proofs)[i]);
+        });
+
+        return res;
+    }
+
+};
@@ -0,0 +1,259 @@
+/**
+ *  @file    merkle_proof.hpp
+ *  @brief   Proof formats: compact wire format with a zero-copy view over it and range proofs
+ *  @author  https://github.com/gdaneek
+ *  @date    16.10.2026
+ *  @version 1.1
+ *  @see https://github.com/gdaneek/merkle-tree
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+namespace merkle {
+
+    /**
+     * @brief constants and size helpers of the compact proof format
+     * @details
+     * The proof is laid out as one contiguous byte string:
+     * - 1 byte of flags (see `with_root`)
+     * - 1 byte with the number of siblings (the tree height)
+     * - ceil(height / 8) bytes of direction mask, bit `i` is set if the sibling of level `i` is on the left.
+     *   The mask is exactly the lowest `height` bits of the leaf index, stored little-endian
+     * - `height` sibling hashes, from the leaves to the root, `sizeof(Hash)` bytes each
+     * - optionally the root hash (omitted when the verifier already knows the trusted root)
+     */
+    namespace compact_proof {
+
+        inline constexpr uint8_t with_root = 0x01; ///< flag: root hash is stored after the siblings
+
+        constexpr size_t mask_size(const size_t height) {
+            return (height + 7) >> 3;
+        }
+
+        constexpr size_t header_size(const size_t height) {
+            return 2 + mask_size(height);
+        }
+
+        /**
+         * @brief number of bytes occupied by a serialized proof
+         * @param height number of siblings in the proof
+         * @param root whether the root hash is stored in the proof
+         */
+        template<typename Hash>
+        constexpr size_t size(const size_t height, const bool root) {
+            return header_size(height) + (height + root) * sizeof(Hash);
+        }
+
+
+        /**
+         * @brief writes a proof in the compact format
+         * @param out destination buffer of at least `size<Hash>(height, root != nullptr)` bytes
+         * @param leaf_idx index of the proven leaf, its lowest bits form the direction mask
+         * @param height number of siblings
+         * @param sibling callable returning the sibling hash of level `i` (0 for the leaves layer)
+         * @param root pointer to the root hash or nullptr to omit it
+         * @return number of bytes written
+         */
+        template<typename Hash>
+        size_t write(void* out, uint64_t leaf_idx, const size_t height, auto&& sibling, const Hash* root = nullptr) {
+            static_assert(std::is_trivially_copyable_v<Hash>, "compact proofs store hashes as raw bytes");
+
+            auto bytes = static_cast<unsigned char*>(out);
+            bytes[0] = root? with_root : 0;
+            bytes[1] = static_cast<unsigned char>(height);
+
+            for(size_t i{};i < mask_size(height);++i, leaf_idx >>= 8)
+                bytes[2 + i] = static_cast<unsigned char>(leaf_idx & 0xFF);
+
+            if(height & 7)  // drop the bits above the tree height
+                bytes[1 + mask_size(height)] &= (1u << (height & 7)) - 1;
+
+            auto pos = bytes + header_size(height);
+            for(size_t i{};i < height;++i, pos += sizeof(Hash)) {
+                const Hash h = sibling(i);
+                memcpy(pos, &h, sizeof(Hash));
+            }
+
+            if(root)
+                memcpy(pos, root, sizeof(Hash));
+
+            return size<Hash>(height, root != nullptr);
+        }
+    }
+
+
+    /**
+     * @brief non-owning view of a proof serialized in the compact format
+     * @details
+     * Reads the directions and hashes directly from the underlying buffer (e.g. a network packet),
+     * no intermediate containers are built. Hashes are copied out one by one, so the buffer
+     * does not have to be aligned.
+     * @tparam Hash type of the stored hashes (must be trivially copyable)
+     * @warning the view does not own the buffer, it must outlive the view
+     */
+    template<typename Hash>
+    class ProofView {
+        static_assert(std::is_trivially_copyable_v<Hash>, "compact proofs store hashes as raw bytes");
+
+        const unsigned char* m_data; ///< beginning of the serialized proof
+        size_t m_len; ///< length of the buffer
+
+    public:
+
+        /**
+         * @param data pointer to the serialized proof
+         * @param len length of the buffer, it is checked against the header by `valid`
+         */
+        ProofView(const void* data, const size_t len)
+        : m_data{static_cast<const unsigned char*>(data)}, m_len{len} {}
+
+
+        /**
+         * @brief checks that the buffer length matches the proof header and the mask has no bits above the height
+         * @details so every proof has exactly one encoding
+         */
+        bool valid() const {
+            return m_len >= 2 && !(m_data[0] & ~compact_proof::with_root)
+                && m_len == compact_proof::size<Hash>(height(), has_root())
+                && !((height() & 7) && (m_data[1 + compact_proof::mask_size(height())] >> (height() & 7)));
+        }
+
+
+        /**
+         * @brief number of siblings in the proof
+         */
+        size_t height() const {
+            return m_data[1];
+        }
+
+
+        bool has_root() const {
+            return m_data[0] & compact_proof::with_root;
+        }
+
+
+        /**
+         * @brief direction of the sibling at level `i`
+         * @return true if the sibling is the left child (current hash is on the right)
+         */
+        bool direction(const size_t i) const {
+            return (m_data[2 + (i >> 3)] >> (i & 7)) & 1;
+        }
+
+
+        /**
+         * @brief index of the proven leaf restored from the direction mask
+         */
+        uint64_t leaf_index() const {
+            uint64_t idx{};
+            for(size_t i = compact_proof::mask_size(height());i;--i)
+                idx = (idx << 8) | m_data[1 + i];
+
+            return idx;
+        }
+
+
+        Hash sibling(const size_t i) const {
+            Hash h;
+            memcpy(&h, m_data + compact_proof::header_size(height()) + i * sizeof(Hash), sizeof(Hash));
+            return h;
+        }
+
+
+        /**
+         * @brief root hash stored in the proof
+         * @warning makes sense only if `has_root` returns true
+         */
+        Hash root() const {
+            return sibling(height());
+        }
+
+
+        /**
+         * @brief folds the proof starting from the leaf hash
+         * @param leaf hash of the proven leaf
+         * @param node_hash callable that hashes two child nodes
+         * @return root hash implied by the proof
+         */
+        Hash compute_root(Hash curr, auto&& node_hash) const {
+            for(size_t i{};i < height();++i)
+                curr = direction(i)? static_cast<Hash>(node_hash(sibling(i), curr))
+                                   : static_cast<Hash>(node_hash(curr, sibling(i)));
+
+            return curr;
+        }
+    };
+
+
+    /**
+     * @brief proof of inclusion of a run of consecutive leaves [first, last)
+     * @details
+     * Contains only the hashes adjacent to the left and right boundaries of the run on each layer
+     * (at most 2 per layer), from the leaves to the root; on each layer the left one goes first.
+     * Siblings that are copies of the last node of an odd-sized layer are not stored,
+     * the verifier restores them from the number of leaves
+     */
+    template<typename Hash>
+    struct RangeProof {
+        size_t first{}; ///< index of the first proven leaf
+        size_t last{};  ///< index after the last proven leaf
+        std::vector<Hash> hashes{}; ///< boundary hashes
+    };
+
+
+    /**
+     * @brief restores the root from a run of leaf hashes and a range proof
+     * @details
+     * Uses the same odd-node duplication semantics as `FixedSizeTree::build`
+     * @param leafs_n number of leaves in the tree
+     * @param proof range proof, `proof.last - proof.first` must be equal to the number of leaf hashes
+     * @param leaves hashes of the leaves [proof.first, proof.last)
+     * @param node_hash callable that hashes two child nodes
+     * @return pair of the success flag (false for an inconsistent proof) and the restored root
+     * @note O(m + logN) hashes are calculated where m is the number of leaves in the run
+     */
+    template<typename Hash>
+    std::pair<bool, Hash> compute_range_root(uint64_t leafs_n, const RangeProof<Hash>& proof, std::vector<Hash> leaves, auto&& node_hash) {
+        auto [l, r] = std::make_pair(proof.first, proof.last);
+        if(l >= r || r > leafs_n || leaves.size() != r - l)
+            return {false, Hash{}};
+
+        size_t p{};
+        auto next_sibling = [&](Hash& dst) {
+            return p < proof.hashes.size()? (dst = proof.hashes[p++], true) : false;
+        };
+
+        std::vector<Hash> layer{};
+        for(auto n = leafs_n;n > 1;n = (n + 1) >> 1, l >>= 1, r = (r + 1) >> 1) {
+            layer.clear();
+            layer.resize((l & 1) + leaves.size() + (r & 1));
+
+            if((l & 1) && !next_sibling(layer.front()))
+                return {false, Hash{}};
+
+            std::copy(leaves.begin(), leaves.end(), layer.begin() + (l & 1));
+
+            if(r & 1) {
+                if(r < n && !next_sibling(layer.back()))
+                    return {false, Hash{}};
+                else if(r == n)
+                    layer.back() = leaves.back();   // copy of the last node of an odd-sized layer
+            }
+
+            leaves.resize(layer.size() >> 1);
+            for(size_t i{};i < leaves.size();++i)
+                leaves[i] = node_hash(layer[i << 1], layer[(i << 1) + 1]);
+        }
+
+        return {p == proof.hashes.size(), leaves.front()};
+    }
+
+};
@@ -0,0 +1,271 @@
+/**
+ *  @file    merkle_soa.hpp
+ *  @brief   Fixed size tree stored as word planes (struct of arrays) for multi-buffer hashing of layers
+ *  @author  https://github.com/gdaneek
+ *  @date    16.10.2026
+ *  @version 1.1
+ *  @see https://github.com/gdaneek/merkle-tree
+ */
+
+#pragma once
+
+#include <array>
+#include <bit>
+#include <concepts>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "merkle.hpp"
+
+namespace merkle {
+
+    /**
+     * @brief FixedSizeTree with the hashes of every layer stored as interleaved word planes
+     * @details
+     * A layer is split into groups of 8 hashes; a group keeps word 0 of its 8 hashes, then word 1, etc.
+     * (words are big-endian 32-bit pieces of a hash). This is the layout of the lanes of multi-buffer
+     * hashing, so with Sha256 a group of 8 parents is computed by Sha256x8 straight from the child planes,
+     * without gathering hashes into messages and scattering digests back. Leaves are hashed one by one
+     * and stored into the planes. Other hashers (or concatenators) fall back to `node_hash` per node.
+     *
+     * Tree shape, root and proofs are the same as of FixedSizeTree with the same parameters; accessors return
+     * ordinary `Hash` values
+     * @tparam Hasher type of hash function, its value type must be a multiple of 4 bytes
+     * @tparam LEAFS_N the number of leaves in the tree
+     */
+    template<typename Hasher, uint64_t LEAFS_N, typename Concatenator = bconcat::UnifiedConcatenator>
+    class SoaTree : public TreeBase<SoaTree<Hasher, LEAFS_N, Concatenator>, Hasher, Concatenator> {
+
+        using Base = TreeBase<SoaTree<Hasher, LEAFS_N, Concatenator>, Hasher, Concatenator>;
+
+    public:
+        using hash_type = typename Hasher::value_type;
+        using proof_type = std::pair<hash_type, std::array<std::pair<hash_type, bool>, Base::height(LEAFS_N) + 1>>;
+
+        static constexpr size_t lanes = Sha256x8::lanes;
+        static constexpr size_t words = sizeof(hash_type) / 4;
+
+    private:
+        using Hash = hash_type;
+
+        static_assert(sizeof(Hash) % 4 == 0 && std::is_trivially_copyable_v<Hash>, "hashes are stored as 32-bit words");
+
+        struct alignas(32) Group {
+            std::array<std::array<uint32_t, lanes>, words> w; ///< w[word][lane]
+        };
+
+        static constexpr size_t height = Base::height(LEAFS_N);
+
+        /**
+         * @return first group of every layer (from the leaves) and the layer lengths without the padding copy
+         */
+        static constexpr auto layers() {
+            std::array<size_t, height + 2> offset{};
+            std::array<size_t, height + 1> len{};
+            len[0] = LEAFS_N;
+            for(size_t k{};k <= height;++k) {
+                offset[k + 1] = offset[k] + (len[k] + (len[k] & 1) + lanes - 1) / lanes;
+                if(k < height)
+                    len[k + 1] = (len[k] + 1) >> 1;
+            }
+
+            return std::make_pair(offset, len);
+        }
+
+        /**
+         * @return first group of the layer, from offsets computed once at compile time
+         */
+        static size_t first_group(const size_t layer) {
+            static constexpr auto offset = layers().first;
+            return offset[layer];
+        }
+
+        /**
+         * @brief whether the node hash input is `node_salt` (4 bytes) followed by the children, so Sha256x8 applies
+         */
+        static constexpr bool multi_buffer = std::same_as<Hasher, Sha256> && sizeof(Base::node_salt) == 4 && LEAFS_N > 1
+            && (std::same_as<Concatenator, bconcat::UnifiedConcatenator> || std::same_as<Concatenator, bconcat::TrivialConcatenator>
+                || std::same_as<Concatenator, bconcat::SegmentConcatenator> || std::same_as<Concatenator, bconcat::ScratchConcatenator>);
+
+        std::vector<Group> m_groups = std::vector<Group>(first_group(height + 1));
+
+
+        uint32_t& word(const size_t layer, const size_t i, const size_t w) {
+            return m_groups[first_group(layer) + i / lanes].w[w][i % lanes];
+        }
+
+        uint32_t word(const size_t layer, const size_t i, const size_t w) const {
+            return m_groups[first_group(layer) + i / lanes].w[w][i % lanes];
+        }
+
+
+        /**
+         * @brief computes the 8 parents of group `g` of layer `layer + 1` with Sha256x8
+         */
+        void hash_group(const size_t layer, const size_t g) {
+            constexpr auto salt = std::bit_cast<std::array<uint8_t, 4>>(Base::node_salt);
+            constexpr uint32_t salt_word = uint32_t{salt[0]} << 24 | uint32_t{salt[1]} << 16 | uint32_t{salt[2]} << 8 | salt[3];
+
+            const size_t first = first_group(layer), groups = first_group(layer + 1) - first;
+            const Group zero{};
+            const Group& lo = m_groups[first + 2 * g];
+            const Group& hi = 2 * g + 1 < groups? m_groups[first + 2 * g + 1] : zero;
+
+            Sha256x8::Block block0{}, block1{};
+            block0[0].fill(salt_word);
+            for(size_t l{};l < lanes;++l) {
+                const Group& src = l < lanes / 2? lo : hi;
+                const size_t left = (2 * l) % lanes, right = left + 1;
+                for(size_t w{};w < 8;++w)
+                    block0[1 + w][l] = src.w[w][left];
+                for(size_t w{};w < 7;++w)
+                    block0[9 + w][l] = src.w[w][right];
+                block1[0][l] = src.w[7][right];
+            }
+            block1[1].fill(0x80000000);
+            block1[15].fill((4 + 2 * sizeof(Hash)) * 8);
+
+            auto h = Sha256x8::init();
+            Sha256x8::compress(h, block0);
+            Sha256x8::compress(h, block1);
+
+            m_groups[first_group(layer + 1) + g].w = h;
+        }
+
+    public:
+
+        template<typename T>
+        explicit SoaTree(T&& _data) : Base::TreeBase() {
+            build(std::forward<T>(_data));
+        }
+
+        SoaTree() : Base() {}
+
+
+        /**
+         * @return hash `i` of the layer `layer` counted from the leaves (0 for the leaves)
+         */
+        Hash get(const size_t layer, const size_t i) const {
+            std::array<uint8_t, sizeof(Hash)> bytes{};
+            for(size_t w{};w < words;++w) {
+                const uint32_t x = word(layer, i, w);
+                for(size_t b{};b < 4;++b)
+                    bytes[4 * w + b] = static_cast<uint8_t>(x >> (24 - 8 * b));
+            }
+
+            return std::bit_cast<Hash>(bytes);
+        }
+
+
+        /**
+         * @brief stores hash `i` of the layer `layer` counted from the leaves
+         */
+        void set(const size_t layer, const size_t i, const Hash& hash) {
+            auto bytes = std::bit_cast<std::array<uint8_t, sizeof(Hash)>>(hash);
+            for(size_t w{};w < words;++w)
+                word(layer, i, w) = uint32_t{bytes[4 * w]} << 24 | uint32_t{bytes[4 * w + 1]} << 16
+                                  | uint32_t{bytes[4 * w + 2]} << 8 | bytes[4 * w + 3];
+        }
+
+
+        /**
+         * @brief builds the tree from a container of LEAFS_N elements
+         * @return this object
+         * @note O(N) complexity where N is equal to the number of hashes in the tree
+         */
+        auto& build(auto&& ccont) {
+            if constexpr (LEAFS_N == 1) {
+                set(0, 0, this->node_hash(*ccont.begin()));
+                return *this;
+            }
+
+            const auto [offset, len] = layers();
+            size_t it{};
+            for(auto&& x : ccont)
+                set(0, it++, this->leaf_hash(x));
+
+            for(size_t k{};k < height;++k) {
+                if(len[k] & 1)
+                    for(size_t w{};w < words;++w)
+                        word(k, len[k], w) = word(k, len[k] - 1, w);
+
+                if constexpr (multi_buffer) {
+                    for(size_t g{};g < offset[k + 2] - offset[k + 1];++g)
+                        hash_group(k, g);
+                }
+                else {
+                    for(size_t i{};i < len[k + 1];++i)
+                        set(k + 1, i, this->node_hash(get(k, 2 * i), get(k, 2 * i + 1)));
+                }
+            }
+
+            return *this;
+        }
+
+
+        Hash root() const {
+            return get(height, 0);
+        }
+
+
+        static constexpr auto get_leafs_n() {
+            return LEAFS_N;
+        }
+
+
+        /**
+         * @brief view of the leaf hashes, indexable like the data of FixedSizeTree
+         */
+        auto data() const {
+            struct Leaves {
+                const SoaTree* tree;
+
+                Hash operator[](const size_t i) const {
+                    return tree->get(0, i);
+                }
+            };
+
+            return Leaves{this};
+        }
+
+
+        /**
+         * @brief creates a proof of inclusion, the same as FixedSizeTree::get_proof
+         * @note O(logN) complexity where N is equal to the number of hashes in the tree
+         */
+        proof_type get_proof(auto&& data) const {
+            typename proof_type::second_type proof{};
+            if constexpr (LEAFS_N == 1)
+                return this->node_hash(data) == root()? proof_type{root(), {std::make_pair(root(), bool{})}} : proof_type{};
+
+            auto idx = this->find_leaf(data);
+            if(idx == (size_t)-1)
+                return std::make_pair(Hash{}, proof);
+
+            auto initial = get(0, idx);
+            for(size_t i{};i < height;++i, idx >>= 1)
+                proof[i] = std::make_pair(get(i, idx ^ 1), (bool)(idx & 1));
+
+            proof[proof.size() - 1] = std::make_pair(root(), bool{});
+
+            return std::make_pair(initial, proof);
+        }
+
+
+        /**
+         * @brief checks a proof of inclusion created by `get_proof`
+         */
+        template<typename Proof>
+        bool verify_proof(auto&& data, Proof&& proof) const {
+            Hash curr_hash = this->leaf_hash(data);
+            for(size_t i{};i + 1 < proof.size();++i)
+                curr_hash = proof[i].second? this->node_hash(proof[i].first, curr_hash)
+                                           : this->node_hash(curr_hash, proof[i].first);
+
+            return curr_hash == proof[proof.size() - 1].first;
+        }
+    };
+
+};
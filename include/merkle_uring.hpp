@@ -0,0 +1,262 @@
+/**
+ *  @file    merkle_uring.hpp
+ *  @brief   Linux io_uring reader for the file and chunk leaf builders
+ *  @author  https://github.com/gdaneek
+ *  @date    16.10.2026
+ *  @version 1.1
+ *  @see https://github.com/gdaneek/merkle-tree
+ */
+
+#pragma once
+
+#include "merkle_fs.hpp"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <vector>
+
+#if __has_include(<linux/io_uring.h>)
+#define MERKLE_HAS_IO_URING 1
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+
+namespace merkle {
+
+    /**
+     * @brief AsyncReader over an io_uring instance, talks to the kernel with raw system calls (no liburing)
+     * @details
+     * Requests are queued in the submission ring and submitted in one `io_uring_enter` call
+     * when the caller waits for a completion, so a burst of `submit` calls costs one system call.
+     * The buffers are registered in the ring and read with IORING_OP_READ_FIXED, which saves pinning
+     * the pages on every request; if registration is not permitted, plain IORING_OP_READ is used.
+     * The number of reads in flight is bounded by the number of buffers, the rings are sized for it.
+     * Short reads are continued from where they stopped, so a request completes like with PreadReader.
+     * @note If io_uring is not supported by the system or forbidden (e.g. by seccomp in containers)
+     * `valid()` returns false; use PreadReader then
+     */
+    class UringReader {
+    public:
+        using Options = PreadReader::Options; ///< `threads` is ignored
+
+    private:
+
+        struct Request {
+            int fd;
+            uint64_t offset;
+            size_t len, done;
+            uint64_t tag;
+            bool active;
+        };
+
+        ReadBuffers m_bufs;
+        std::vector<Request> m_requests; ///< request reading into each buffer
+        int m_fd{-1};
+        int m_error{}; ///< errno of a failed `io_uring_enter`, the ring is not used after it
+        bool m_fixed{}; ///< buffers are registered
+
+#ifdef MERKLE_HAS_IO_URING
+        void* m_sq_ring{MAP_FAILED};
+        void* m_cq_ring{MAP_FAILED};
+        size_t m_sq_ring_size{}, m_cq_ring_size{}, m_sqes_size{};
+        io_uring_sqe* m_sqes{static_cast<io_uring_sqe*>(MAP_FAILED)};
+        io_uring_cqe* m_cqes{};
+        unsigned *m_sq_head{}, *m_sq_tail{}, *m_sq_array{}, *m_cq_head{}, *m_cq_tail{};
+        unsigned m_sq_mask{}, m_cq_mask{}, m_sq_entries{};
+        unsigned m_to_submit{};
+
+
+        static unsigned* field(void* ring, const unsigned offset) {
+            return reinterpret_cast<unsigned*>(static_cast<char*>(ring) + offset);
+        }
+
+
+        int enter(const unsigned to_submit, const unsigned min_complete, const unsigned flags) {
+            return static_cast<int>(syscall(__NR_io_uring_enter, m_fd, to_submit, min_complete, flags, nullptr, 0));
+        }
+
+
+        /**
+         * @brief passes queued requests to the kernel
+         * @param min_complete number of completions to wait for
+         * @return false if the ring failed (see m_error)
+         */
+        bool flush(const unsigned min_complete) {
+            while(!m_error && (m_to_submit || min_complete)) {
+                int r = enter(m_to_submit, min_complete, min_complete? IORING_ENTER_GETEVENTS : 0);
+                if(r < 0 && (errno == EINTR || errno == EAGAIN || errno == EBUSY))
+                    continue;
+                if(r < 0)
+                    m_error = errno;
+                else m_to_submit -= std::min<unsigned>(r, m_to_submit);
+                break;
+            }
+
+            return !m_error;
+        }
+
+
+        /**
+         * @brief queues a read of the rest of the buffer's request
+         */
+        void push(const size_t buf) {
+            auto& req = m_requests[buf];
+            unsigned tail = *m_sq_tail;
+            unsigned idx = tail & m_sq_mask;   // the ring has an entry for every buffer
+            auto& sqe = m_sqes[idx];
+            std::memset(&sqe, 0, sizeof(sqe));
+            sqe.opcode = m_fixed? IORING_OP_READ_FIXED : IORING_OP_READ;
+            sqe.fd = req.fd;
+            sqe.off = req.offset + req.done;
+            sqe.addr = reinterpret_cast<uint64_t>(m_bufs[buf] + req.done);
+            sqe.len = static_cast<unsigned>(req.len - req.done);
+            sqe.buf_index = static_cast<uint16_t>(buf);
+            sqe.user_data = buf;
+
+            m_sq_array[idx] = idx;
+            std::atomic_ref(*m_sq_tail).store(tail + 1, std::memory_order_release);
+            ++m_to_submit;
+        }
+
+
+        /**
+         * @return finished request, short reads are resubmitted from where they stopped (like PreadReader)
+         */
+        std::optional<ReadCompletion> reap() {
+            for(;;) {
+                unsigned head = *m_cq_head;
+                if(head == std::atomic_ref(*m_cq_tail).load(std::memory_order_acquire))
+                    return std::nullopt;
+
+                const auto buf = static_cast<size_t>(m_cqes[head & m_cq_mask].user_data);
+                const auto res = m_cqes[head & m_cq_mask].res;
+                std::atomic_ref(*m_cq_head).store(head + 1, std::memory_order_release);
+
+                auto& req = m_requests[buf];
+                if(res == -EINTR || res == -EAGAIN || (res > 0 && (req.done += res) < req.len)) {
+                    push(buf);
+                    continue;
+                }
+
+                req.active = false;
+                return ReadCompletion{req.tag, buf, res < 0? res : static_cast<ssize_t>(req.done)};
+            }
+        }
+#endif
+
+    public:
+
+        explicit UringReader(const Options opts) : m_bufs{opts.buffers, opts.buffer_size, opts.alignment}, m_requests(m_bufs.count()) {
+#ifdef MERKLE_HAS_IO_URING
+            io_uring_params p{};
+            m_fd = static_cast<int>(syscall(__NR_io_uring_setup, static_cast<unsigned>(std::bit_ceil(m_bufs.count())), &p));
+            if(m_fd < 0)
+                return;
+
+            m_sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+            m_cq_ring_size = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+            if(p.features & IORING_FEAT_SINGLE_MMAP)
+                m_sq_ring_size = m_cq_ring_size = std::max(m_sq_ring_size, m_cq_ring_size);
+
+            m_sq_ring = mmap(nullptr, m_sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQ_RING);
+            m_cq_ring = p.features & IORING_FEAT_SINGLE_MMAP? m_sq_ring
+                : mmap(nullptr, m_cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_CQ_RING);
+            m_sqes_size = p.sq_entries * sizeof(io_uring_sqe);
+            m_sqes = static_cast<io_uring_sqe*>(mmap(nullptr, m_sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQES));
+            if(m_sq_ring == MAP_FAILED || m_cq_ring == MAP_FAILED || m_sqes == MAP_FAILED) {
+                ::close(m_fd), m_fd = -1;
+                return;
+            }
+
+            m_sq_head = field(m_sq_ring, p.sq_off.head), m_sq_tail = field(m_sq_ring, p.sq_off.tail);
+            m_sq_array = field(m_sq_ring, p.sq_off.array), m_sq_mask = *field(m_sq_ring, p.sq_off.ring_mask);
+            m_sq_entries = p.sq_entries;
+            m_cq_head = field(m_cq_ring, p.cq_off.head), m_cq_tail = field(m_cq_ring, p.cq_off.tail);
+            m_cq_mask = *field(m_cq_ring, p.cq_off.ring_mask);
+            m_cqes = reinterpret_cast<io_uring_cqe*>(static_cast<char*>(m_cq_ring) + p.cq_off.cqes);
+
+            std::vector<iovec> iov(m_bufs.count());
+            for(size_t i{};i < iov.size();++i)
+                iov[i] = {m_bufs.region(i).data(), m_bufs.region(i).size()};
+            m_fixed = !syscall(__NR_io_uring_register, m_fd, IORING_REGISTER_BUFFERS, iov.data(), static_cast<unsigned>(iov.size()));
+#endif
+        }
+
+        UringReader(const UringReader&) = delete;
+        UringReader& operator=(const UringReader&) = delete;
+
+        ~UringReader() {
+#ifdef MERKLE_HAS_IO_URING
+            if(m_sqes != MAP_FAILED)
+                munmap(m_sqes, m_sqes_size);
+            if(m_cq_ring != MAP_FAILED && m_cq_ring != m_sq_ring)
+                munmap(m_cq_ring, m_cq_ring_size);
+            if(m_sq_ring != MAP_FAILED)
+                munmap(m_sq_ring, m_sq_ring_size);
+#endif
+            if(m_fd >= 0)
+                ::close(m_fd);
+        }
+
+
+        /**
+         * @brief whether the ring is set up, other methods must not be called otherwise
+         */
+        bool valid() const {
+            return m_fd >= 0;
+        }
+
+
+        /**
+         * @brief whether the buffers are registered in the ring
+         */
+        bool fixed_buffers() const {
+            return m_fixed;
+        }
+
+
+        const ReadBuffers& buffers() const {
+            return m_bufs;
+        }
+
+
+        void submit(const int fd, const uint64_t offset, const size_t len, const size_t buf, const uint64_t tag) {
+            m_requests[buf] = {fd, offset, std::min(len, m_bufs.buffer_size()), 0, tag, true};
+#ifdef MERKLE_HAS_IO_URING
+            if(!m_error)
+                push(buf);
+#endif
+        }
+
+
+        /**
+         * @details If the ring fails, every request in flight is finished with the error of `io_uring_enter`
+         */
+        ReadCompletion wait() {
+#ifdef MERKLE_HAS_IO_URING
+            while(flush(0)) {
+                if(auto done = reap())
+                    return *done;
+                if(!flush(1))
+                    break;
+            }
+
+            const int error = m_error;
+#else
+            const int error = ENOSYS;
+#endif
+            for(size_t buf{};buf < m_requests.size();++buf)
+                if(m_requests[buf].active) {
+                    m_requests[buf].active = false;
+                    return {m_requests[buf].tag, buf, -error};
+                }
+
+            return {0, 0, -error};
+        }
+    };
+
+};
@@ -11,9 +11,18 @@
 #pragma once
 
 #include <iostream> // for << operator
+#include <atomic>
+#include <bit>
+#include <memory>
+#include <ranges>
+#include <vector>
 
 #include "merkle_utils.hpp"
 #include "bytes_concat.hpp"
+#include "merkle_instrumentation.hpp"
+#include "merkle_hashers.hpp"
+#include "merkle_proof.hpp"
+#include "merkle_diff.hpp"
 
 namespace merkle {
 
@@ -44,12 +53,16 @@ namespace merkle {
      * and two generalized algorithms for building a tree (todo status).
      * @tparam Derived concrete implementation of the Merkle tree
      * @tparam HashFunc type of hash function
+     * @tparam Instrumentation policy notified about every hash call (see merkle_instrumentation.hpp).
+     * The default one is empty and adds no overhead
      */
-    template<typename Derived, typename Hasher, typename Concatenator = bconcat::UnifiedConcatenator>
+    template<typename Derived, typename Hasher, typename Concatenator = bconcat::UnifiedConcatenator,
+             typename Instrumentation = NoInstrumentation>
     class TreeBase {
 
-        Hasher m_hash; ///<  hash function
-        Concatenator m_concat; ///< hashes concatenation func
+        [[no_unique_address]] Hasher m_hash; ///<  hash function
+        [[no_unique_address]] Concatenator m_concat; ///< hashes concatenation func
+        [[no_unique_address]] mutable Instrumentation m_instr; ///< hash calls counters
 
     protected:
 
@@ -58,10 +71,18 @@ namespace merkle {
          * @param h link to the hash function that will be used to build the tree
          */
         constexpr explicit TreeBase(Hasher h, Concatenator c)
-        : m_hash{h}, m_concat{c} {}
+        : m_hash{h}, m_concat{c}, m_instr{} {}
 
         constexpr TreeBase()
-        : m_hash{}, m_concat{} {}
+        : m_hash{}, m_concat{}, m_instr{} {}
+
+
+        /**
+         * @brief access to the concrete implementation (CRTP downcast, allowed in constant expressions)
+         */
+        constexpr const Derived& derived() const {
+            return static_cast<const Derived&>(*this);
+        }
 
 
         /**
@@ -73,11 +94,9 @@ namespace merkle {
          */
         template<typename... Args>
         constexpr auto find_leaf(Args&&... data) const {
-            // TODO: it not constexpr because using reinterpret_cast. need refactor
-
             auto lhash = leaf_hash(std::forward<Args>(data)...);
-            auto leafs_n = reinterpret_cast<const Derived*>(this)->get_leafs_n();
-            auto idata = reinterpret_cast<const Derived*>(this)->data();
+            auto leafs_n = derived().get_leafs_n();
+            auto idata = derived().data();
 
             if constexpr (Iterable<decltype(idata)>) {
                 for(auto it = idata.begin();it != idata.end();it++)
@@ -97,7 +116,9 @@ namespace merkle {
 
         template<typename... Args>
         constexpr auto hash(Args&&... args) const {
-            return m_hash(std::forward<Args>(args)...);
+            if constexpr (sizeof...(Args) == 1 && (bconcat::Segmented<std::remove_cvref_t<Args>> && ...) && SegmentHasher<Hasher>)
+                return hash_segments(m_hash, args...);
+            else return m_hash(std::forward<Args>(args)...);
         }
 
 
@@ -107,8 +128,16 @@ namespace merkle {
         }
 
 
+        constexpr auto& instrumentation() const {
+            return m_instr;
+        }
+
+
         public:
 
+        static constexpr int leaf_salt = 0x00; ///< prefix of leaf hash inputs (for tests only)
+        static constexpr int node_salt = 0x01; ///< prefix of node hash inputs (for tests only)
+
         /**
          * @brief calculates the hash of a tree leaf
          * @details
@@ -118,9 +147,10 @@ namespace merkle {
          */
         template<typename... Args>
         constexpr auto leaf_hash(Args&&... args) const {
-            constexpr int leaf_salt = 0x00; // for tests only
             // TODO: can be well optimized if you spread the salt in advance
-            return hash(m_concat(leaf_salt, std::forward<Args>(args)...));
+            auto bytes = m_concat(leaf_salt, std::forward<Args>(args)...);
+            m_instr.on_leaf_hash(bytes);
+            return hash(bytes);
         }
 
 
@@ -130,9 +160,91 @@ namespace merkle {
          */
         template<typename... Args>
         constexpr auto node_hash(Args&&... args) const {
-            constexpr int node_salt = 0x01; // for tests only
             // TODO: can be well optimized if you spread the salt in advance
-            return hash(m_concat(node_salt, std::forward<Args>(args)...));
+            auto bytes = m_concat(node_salt, std::forward<Args>(args)...);
+            m_instr.on_node_hash(bytes);
+            return hash(bytes);
+        }
+
+
+        /**
+         * @brief leaf_hash looked up in the cache by its input, hashed and stored only on a miss
+         * @details If the concatenator does not frame byte ranges, the key is taken from the arguments in place
+         * and the leaf is concatenated only on a miss
+         * @param cache e.g. HashCache, only misses are reported to the instrumentation
+         */
+        template<typename Cache, typename... Args>
+        auto cached_leaf_hash(Cache& cache, Args&&... args) const {
+            if constexpr (bconcat::plain_byte_ranges<Concatenator>) {
+                auto key = Cache::key(bconcat::SegmentConcatenator::concat(leaf_salt, args...));
+                return cache.get_or_compute(key, [&] { return leaf_hash(std::forward<Args>(args)...); });
+            } else {
+                auto bytes = m_concat(leaf_salt, std::forward<Args>(args)...);
+                return cache.get_or_compute(Cache::key(bytes), [&] { m_instr.on_leaf_hash(bytes); return hash(bytes); });
+            }
+        }
+
+
+        /**
+         * @brief node_hash looked up in the cache by its input (the salt and the child hashes)
+         */
+        template<typename Cache, typename... Args>
+        auto cached_node_hash(Cache& cache, Args&&... args) const {
+            auto bytes = m_concat(node_salt, std::forward<Args>(args)...);
+            return cache.get_or_compute(Cache::key(bytes), [&] { m_instr.on_node_hash(bytes); return hash(bytes); });
+        }
+
+
+        /**
+         * @brief concatenated leaf salt, the beginning of every leaf hash input
+         */
+        constexpr auto leaf_prefix() const {
+            return m_concat(leaf_salt);
+        }
+
+
+        /**
+         * @brief calculates the hash of a tree leaf whose bytes are already preceded by `leaf_prefix()`
+         * @details
+         * Equivalent to `leaf_hash(data)` for a byte range `data`, but lets the caller write the salt right before
+         * the data in its own buffer and hash it in place, without concatenation copies.
+         * Available only for concatenators that do not frame byte ranges (see bconcat::plain_byte_ranges),
+         * with others (e.g. DeepConcatenator, TrivialConcatenator) the result would differ from `leaf_hash`
+         * @param prefixed contiguous bytes: `leaf_prefix()` followed by the leaf data
+         */
+        template<typename Bytes> requires bconcat::plain_byte_ranges<Concatenator>
+        constexpr auto prefixed_leaf_hash(Bytes&& prefixed) const {
+            m_instr.on_leaf_hash(prefixed);
+            return hash(std::forward<Bytes>(prefixed));
+        }
+
+
+        /**
+         * @brief calculates `leaf_hash(args...)` passing the arguments to the hasher state one after another
+         * @details
+         * Byte ranges are hashed where they are, without gathering them into one buffer. Falls back to `leaf_hash`
+         * if the hasher has no incremental state (see SegmentHasher) or the concatenator frames byte ranges
+         */
+        template<typename... Args>
+        auto segmented_leaf_hash(Args&&... args) const {
+            if constexpr (SegmentHasher<Hasher> && bconcat::plain_byte_ranges<Concatenator>) {
+                auto segs = bconcat::SegmentConcatenator::concat(leaf_salt, std::forward<Args>(args)...);
+                m_instr.on_leaf_hash(segs);
+                return hash_segments(m_hash, segs);
+            } else return leaf_hash(std::forward<Args>(args)...);
+        }
+
+
+        /**
+         * @brief snapshot of the instrumentation counters (all zeros for the default policy)
+         */
+        auto stats() const {
+            return m_instr.snapshot();
+        }
+
+
+        void reset_stats() {
+            m_instr.reset();
         }
 
 
@@ -152,8 +264,8 @@ namespace merkle {
          * @return tree height
          * @warning If the tree has zero or one (only root) nodes, then the height is zero
          */
-        size_t height() const {
-            return height(reinterpret_cast<const Derived*>(this)->get_leafs_n());
+        constexpr size_t height() const {
+            return height(derived().get_leafs_n());
         }
 
 
@@ -166,7 +278,7 @@ namespace merkle {
          * @return number of hashes in tree
          */
         constexpr size_t size() const {
-            return this->size(reinterpret_cast<const Derived*>(this)->get_leafs_n());
+            return this->size(derived().get_leafs_n());
         }
 
 
@@ -204,25 +316,83 @@ namespace merkle {
      * since the construction algorithm is much simpler for it, and the additional memory consumption is insignificant.
      * @tparam Hasher type of hash function
      * @tparam LEAFS_N  the number of leaves in the tree calculated at the compilation stage
+     * @tparam Instrumentation hash calls counting policy, e.g. CountingInstrumentation (see TreeBase)
      */
-    template<typename Hasher, uint64_t LEAFS_N, typename Hash = Hasher::value_type, typename Concatenator = bconcat::UnifiedConcatenator>
-    class FixedSizeTree : public TreeBase<FixedSizeTree<Hasher, LEAFS_N, Hash, Concatenator>, Hasher, Concatenator> {
+    template<typename Hasher, uint64_t LEAFS_N, typename Hash = Hasher::value_type, typename Concatenator = bconcat::UnifiedConcatenator,
+             typename Instrumentation = NoInstrumentation>
+    class FixedSizeTree : public TreeBase<FixedSizeTree<Hasher, LEAFS_N, Hash, Concatenator, Instrumentation>, Hasher, Concatenator, Instrumentation> {
 
         // TODO: Custom concatenator with support for implicit concatenation while build like in v1.0
 
-        using Base = TreeBase<FixedSizeTree<Hasher, LEAFS_N, Hash, Concatenator>, Hasher, Concatenator>;
+        using Base = TreeBase<FixedSizeTree<Hasher, LEAFS_N, Hash, Concatenator, Instrumentation>, Hasher, Concatenator, Instrumentation>;
 
         inline static constexpr auto SIZE = calc_tree_size(LEAFS_N); ///< number of hashes in tree
         std::array<Hash, SIZE> m_data; ///< flattened hashes tree
 
-    protected:
+
+        /**
+         * @return offsets of the layers in m_data and their lengths without the padding copy, from the leaves
+         */
+        static constexpr auto layers() {
+            constexpr auto height = Base::height(LEAFS_N);
+            std::array<size_t, height + 1> offset{}, len{};
+            len[0] = LEAFS_N;
+            for(size_t k{};k < height;++k)
+                offset[k + 1] = offset[k] + len[k] + (len[k] & 1), len[k + 1] = (len[k] + 1) >> 1;
+
+            return std::make_pair(offset, len);
+        }
+
+
+    public:
+        using hash_type = Hash; ///< type of the stored hashes
+        using proof_type = std::pair<Hash, std::array<std::pair<Hash, bool>, Base::height(LEAFS_N) + 1>>; ///< result of `get_proof`
+
+
+        /**
+         * @brief builds block `b` of `sub` leaves and its subtree up to the subtree root
+         * @details
+         * Building block of the parallel builds (see build_parallel in merkle_parallel.hpp): blocks do not
+         * share any node, so they can be built on different threads, and `build_top` finishes the tree
+         * @param leaves random access iterator to the LEAFS_N inputs
+         * @param sub power of two not greater than LEAFS_N
+         */
+        void build_subtree(auto leaves, const size_t b, const size_t sub) {
+            auto [offset, len] = layers();
+            for(size_t i = b * sub;i < (b + 1) * sub;++i)
+                m_data[i] = this->leaf_hash(leaves[i]);
+
+            for(size_t k = 1;(sub >> k) > 0;++k)
+                for(size_t i = (b * sub) >> k;i < ((b + 1) * sub) >> k;++i)
+                    m_data[offset[k] + i] = this->node_hash(m_data[offset[k - 1] + 2 * i], m_data[offset[k - 1] + 2 * i + 1]);
+        }
+
+
+        /**
+         * @brief builds everything not covered by the subtrees of the first `built` leaves (built by `build_subtree`)
+         * @details The result (including `get_layer`) is identical to `build`
+         */
+        void build_top(auto leaves, const size_t built, const size_t sub) {
+            constexpr auto height = Base::height(LEAFS_N);
+            const size_t sub_height = std::countr_zero(sub);
+            auto [offset, len] = layers();
+            for(size_t k{};k <= height;++k) {
+                size_t i = k <= sub_height? built >> k : 0;
+                for(;i < len[k];++i)
+                    m_data[offset[k] + i] = k? this->node_hash(m_data[offset[k - 1] + 2 * i], m_data[offset[k - 1] + 2 * i + 1])
+                                             : this->leaf_hash(leaves[i]);
+                if(k < height && (len[k] & 1))
+                    m_data[offset[k] + len[k]] = m_data[offset[k] + len[k] - 1];
+            }
+        }
 
 
         /**
          * @brief finds a pointer to a tree layer by index and its size
          * @param idx layer index (0 for the root, 1..N for the following)
          * @return pointer to the beginning of the layer and its length (num of hashes)
-         * @note index of the last layer is equal to the height value
+         * @note index of the last layer is equal to the height value.
+         * The length includes the copy of the last node appended to odd-sized layers
          * O(logN) complexity where N is equal to the number of hashes in the tree
          */
         constexpr auto get_layer(const size_t idx) const { // 0 for root
@@ -233,7 +403,6 @@ namespace merkle {
             return std::make_pair(m_data.data() + offset, n - !idx);
         }
 
-    public:
 
         /**
          * @brief constructor for immediate creation of a tree from a data container
@@ -263,29 +432,206 @@ namespace merkle {
          * @return this object
          * @note O(N) complexity where N is equal to the number of hashes in the tree
          */
-         constexpr auto build(auto&& ccont) { // requires ccont.size() == SIZE
+         constexpr auto& build(auto&& ccont) { // requires ccont.size() == SIZE
 
             if constexpr (LEAFS_N == 1) {
                 m_data[0] = this->node_hash(*ccont.begin());
                 return *this;
             }
 
+            auto& instr = this->instrumentation();
+            auto timer = instr.layer_begin();
+
             size_t it{};
             for(auto&& x : ccont) // i don't want use std::transform
                 m_data[it++] = this->leaf_hash(x);
 
+            instr.layer_end(0, timer);
 
-            for(size_t t{}, l{}, r{LEAFS_N};l < r-1;t = l, l = r, r += ((r - t) >> 1)) {
+            for(size_t t{}, l{}, r{LEAFS_N}, layer{1};l < r-1;t = l, l = r, r += ((r - t) >> 1), ++layer) {
+                timer = instr.layer_begin();
                 if(r & 1) m_data[r++] = m_data[r - 1];
                 for(uint64_t i = 0;i < (r-l)>>1; i++)
                     m_data[r + i] = this->node_hash(m_data[(i<<1) + l], m_data[(i<<1) + l + 1]); // implicit concat available
 
+                instr.layer_end(layer, timer);
             }
 
             return *this;
         }
 
 
+        /**
+         * @brief builds the tree reusing the leaf and node hashes stored in the cache by previous builds
+         * @details
+         * Every hash is looked up by its input before it is computed, and computed hashes are stored.
+         * When the cache holds the previous build, only the changed leaves and the nodes above them are hashed,
+         * the rest costs a concatenation and a lookup. The result is identical to `build`
+         * @param cache e.g. HashCache<Hash> (merkle_cache.hpp), shared by any trees with the same hasher and concatenator
+         */
+        template<typename Cache>
+        auto& build(auto&& ccont, Cache& cache) {
+            if constexpr (LEAFS_N == 1) {
+                m_data[0] = this->cached_node_hash(cache, *ccont.begin());
+                return *this;
+            }
+
+            auto& instr = this->instrumentation();
+            auto timer = instr.layer_begin();
+
+            size_t it{};
+            for(auto&& x : ccont)
+                m_data[it++] = this->cached_leaf_hash(cache, x);
+
+            instr.layer_end(0, timer);
+
+            for(size_t t{}, l{}, r{LEAFS_N}, layer{1};l < r-1;t = l, l = r, r += ((r - t) >> 1), ++layer) {
+                timer = instr.layer_begin();
+                if(r & 1)
+                    m_data[r] = m_data[r - 1], ++r;
+                for(uint64_t i = 0;i < (r-l)>>1; i++)
+                    m_data[r + i] = this->cached_node_hash(cache, m_data[(i<<1) + l], m_data[(i<<1) + l + 1]);
+
+                instr.layer_end(layer, timer);
+            }
+
+            return *this;
+        }
+
+
+        /**
+         * @brief replaces the data of a leaf and recalculates the hashes on its path to the root
+         * @param idx leaf index
+         * @return false if the index is out of range
+         * @note O(logN) complexity
+         */
+        constexpr bool update(const size_t idx, auto&& data) {
+            if(idx >= LEAFS_N)
+                return false;
+
+            if constexpr (LEAFS_N == 1)
+                m_data[0] = this->node_hash(data);
+            else {
+                auto [offset, len] = layers();
+                m_data[idx] = this->leaf_hash(data);
+                for(size_t k{}, i = idx;k < Base::height(LEAFS_N);++k, i >>= 1) {
+                    if(i + 1 == len[k] && (len[k] & 1))
+                        m_data[offset[k] + i + 1] = m_data[offset[k] + i];  // the copy of the last odd node
+
+                    const size_t l = offset[k] + (i & ~size_t{1});
+                    m_data[offset[k + 1] + (i >> 1)] = this->node_hash(m_data[l], m_data[l + 1]);
+                }
+            }
+
+            return true;
+        }
+
+
+        /**
+         * @brief leaf updates made by several threads at once, each thread owning whole subtrees
+         * @details
+         * Leaves are split into aligned subtrees of `subtree_leaves` leaves (partitions). `update` recalculates
+         * the path of the leaf only up to the root of its partition and marks the partition as changed, so
+         * threads updating leaves of different partitions never write the same node. After all writers are done,
+         * `commit` (the merge phase) recalculates every changed ancestor above the partitions once.
+         * The result does not depend on the order or the split of the updates and equals a serial `update` / `build`
+         * @warning a partition must be updated by one thread at a time, `commit` and reading the tree
+         * must happen after the writers are finished (e.g. joined)
+         */
+        class PartitionedUpdate {
+            FixedSizeTree& m_tree;
+            size_t m_sub_height;
+            size_t m_parts;
+            std::unique_ptr<std::atomic<bool>[]> m_dirty;
+
+        public:
+
+            PartitionedUpdate(FixedSizeTree& tree, const size_t subtree_leaves)
+            : m_tree{tree}, m_sub_height(std::countr_zero(std::bit_floor(std::clamp<size_t>(subtree_leaves, 1, std::bit_ceil(LEAFS_N))))),
+              m_parts{((LEAFS_N - 1) >> m_sub_height) + 1}, m_dirty{std::make_unique<std::atomic<bool>[]>(m_parts)} {}
+
+
+            size_t partitions() const {
+                return m_parts;
+            }
+
+
+            /**
+             * @return partition of the leaf `idx`
+             */
+            size_t partition_of(const size_t idx) const {
+                return idx >> m_sub_height;
+            }
+
+
+            /**
+             * @brief replaces the data of a leaf and recalculates its path inside the partition
+             * @return false if the index is out of range
+             */
+            bool update(const size_t idx, auto&& data) {
+                if(idx >= LEAFS_N)
+                    return false;
+
+                auto& d = m_tree.m_data;
+                if constexpr (LEAFS_N == 1)
+                    d[0] = m_tree.node_hash(data);
+                else {
+                    auto [offset, len] = layers();
+                    d[idx] = m_tree.leaf_hash(data);
+                    for(size_t k{}, i = idx;k < std::min(m_sub_height, Base::height(LEAFS_N));++k, i >>= 1) {
+                        if(i + 1 == len[k] && (len[k] & 1))
+                            d[offset[k] + i + 1] = d[offset[k] + i];
+
+                        const size_t l = offset[k] + (i & ~size_t{1});
+                        d[offset[k + 1] + (i >> 1)] = m_tree.node_hash(d[l], d[l + 1]);
+                    }
+                }
+
+                m_dirty[partition_of(idx)].store(true, std::memory_order_relaxed);
+                return true;
+            }
+
+
+            /**
+             * @brief merge phase: recalculates the ancestors of the changed partitions
+             * @return number of recalculated nodes
+             */
+            size_t commit() {
+                std::vector<size_t> dirty{};
+                for(size_t p{};p < m_parts;++p)
+                    if(m_dirty[p].exchange(false, std::memory_order_relaxed))
+                        dirty.push_back(p);
+
+                auto& d = m_tree.m_data;
+                auto [offset, len] = layers();
+                size_t hashed{};
+                for(size_t k = m_sub_height;k < Base::height(LEAFS_N) && !dirty.empty();++k) {
+                    if((len[k] & 1) && dirty.back() == len[k] - 1)
+                        d[offset[k] + len[k]] = d[offset[k] + len[k] - 1];
+
+                    size_t n{};
+                    for(size_t i : dirty)
+                        if(!n || dirty[n - 1] != (i >> 1))
+                            dirty[n++] = i >> 1;
+                    dirty.resize(n);
+
+                    for(size_t i : dirty)
+                        d[offset[k + 1] + i] = m_tree.node_hash(d[offset[k] + 2 * i], d[offset[k] + 2 * i + 1]), ++hashed;
+                }
+
+                return hashed;
+            }
+        };
+
+
+        /**
+         * @brief starts concurrent leaf updates split into subtrees of `subtree_leaves` leaves (see PartitionedUpdate)
+         */
+        PartitionedUpdate partitioned_update(const size_t subtree_leaves) {
+            return PartitionedUpdate(*this, subtree_leaves);
+        }
+
+
         /**
          * @brief creates a proof of inclusion of some data in the tree
          * @param data input for which the proof is being created
@@ -316,12 +662,91 @@ namespace merkle {
         }
 
         /**
-         * ...
+         * @brief serializes a proof of inclusion into the compact format (see merkle_proof.hpp)
+         * @param data input for which the proof is being created
+         * @param with_root whether to store the root hash in the proof.
+         * It can be omitted if the verifier already has the trusted root
+         * @return bytes of the proof or an empty vector if the data was not used to build the tree
          * @note O(logN) complexity where N is equal to the number of hashes in the tree
          */
-        constexpr auto verify_proof(auto&& data, auto&& proof) {  // proof - ...<std::pair<Hash, bool>>
-            auto curr_hash = this->leaf_hash(data);
-            auto supposed_root = proof(proof.size() - 1).first;
+        auto get_compact_proof(auto&& data, const bool with_root = true) const {
+            constexpr auto height = Base::height(LEAFS_N);
+            std::vector<char> bytes{};
+
+            size_t idx{};
+            if constexpr (LEAFS_N == 1) {
+                if(static_cast<Hash>(this->node_hash(data)) != m_data[0])
+                    return bytes;
+            }
+            else if((idx = this->find_leaf(data)) == (size_t)-1)
+                return bytes;
+
+            const auto root = this->root();
+            bytes.resize(compact_proof::size<Hash>(height, with_root));
+            compact_proof::write<Hash>(bytes.data(), idx, height,
+                [&](size_t i) { return get_layer(height - i).first[(idx >> i) ^ 1]; },
+                with_root? &root : nullptr);
+
+            return bytes;
+        }
+
+
+        /**
+         * @brief creates a proof of inclusion of the consecutive leaves [first, last)
+         * @details
+         * Only the boundary paths of the run are stored, so the proof takes about 2·logN hashes
+         * regardless of the run length
+         * @return range proof or an empty proof (first == last) if the range is invalid
+         * @note O(logN) complexity where N is equal to the number of hashes in the tree
+         */
+        auto get_range_proof(const size_t first, const size_t last) const {
+            constexpr auto height = Base::height(LEAFS_N);
+            RangeProof<Hash> proof{};
+            if(first >= last || last > LEAFS_N)
+                return proof;
+
+            proof.first = first, proof.last = last;
+            auto [l, r] = std::make_pair(first, last);
+            for(size_t i{}, n{LEAFS_N};i < height;++i, n = (n + 1) >> 1, l >>= 1, r = (r + 1) >> 1) {
+                auto layer = get_layer(height - i).first;
+                if(l & 1)
+                    proof.hashes.push_back(layer[l - 1]);
+                if((r & 1) && r < n)  // copies of the last node are restored by the verifier
+                    proof.hashes.push_back(layer[r]);
+            }
+
+            return proof;
+        }
+
+
+        /**
+         * @brief checks a range proof against a trusted root
+         * @param run container with the data of leaves [proof.first, proof.last)
+         * @param proof range proof created by `get_range_proof`
+         * @param root trusted root hash
+         * @note O(m + logN) complexity where m is the number of leaves in the run
+         */
+        auto verify_range_proof(auto&& run, const RangeProof<Hash>& proof, const Hash& root) const {
+            std::vector<Hash> leaves{};
+            for(auto&& x : run)
+                leaves.push_back((LEAFS_N == 1)? this->node_hash(x) : this->leaf_hash(x));
+
+            auto [ok, restored] = compute_range_root<Hash>(LEAFS_N, proof, std::move(leaves),
+                                            [this](auto&& lhs, auto&& rhs) { return this->node_hash(lhs, rhs); });
+            return ok && restored == root;
+        }
+
+
+        /**
+         * @brief checks a proof of inclusion
+         * @param data input whose inclusion is being proven
+         * @param proof array of pairs (hash, direction) ending with the root, as returned by `get_proof`
+         * @note O(logN) complexity where N is equal to the number of hashes in the tree
+         */
+        template<typename Proof> requires (!std::same_as<std::remove_cvref_t<Proof>, ProofView<Hash>>)
+        constexpr auto verify_proof(auto&& data, Proof&& proof) const {  // proof - ...<std::pair<Hash, bool>>
+            Hash curr_hash = this->leaf_hash(data);
+            auto supposed_root = proof[proof.size() - 1].first;
             for(auto i = 0;i < proof.size() - 1;++i)
                 curr_hash = proof[i].second?  this->node_hash(proof[i].first, curr_hash)
                                            :  this->node_hash(curr_hash, proof[i].first);
@@ -330,6 +755,31 @@ namespace merkle {
         }
 
 
+        /**
+         * @brief checks a compact proof of inclusion against a trusted root
+         * @param data input whose inclusion is being proven
+         * @param proof view of the serialized proof, the stored root (if any) is ignored
+         * @param root trusted root hash
+         * @note O(logN) complexity, no allocations
+         */
+        bool verify_proof(auto&& data, const ProofView<Hash>& proof, const Hash& root) const {
+            if(!proof.valid() || proof.height() != Base::height(LEAFS_N))
+                return false;
+
+            const Hash leaf = (LEAFS_N == 1)? this->node_hash(data) : this->leaf_hash(data);
+            return proof.compute_root(leaf, [this](auto&& lhs, auto&& rhs) { return this->node_hash(lhs, rhs); }) == root;
+        }
+
+
+        /**
+         * @brief checks a compact proof of inclusion against the root stored in it
+         * @warning the stored root must be compared with a trusted one separately
+         */
+        bool verify_proof(auto&& data, const ProofView<Hash>& proof) const {
+            return proof.valid() && proof.has_root() && verify_proof(data, proof, proof.root());
+        }
+
+
         /**
          * @brief root of the Merkle tree
          * @return last (topmost) hash
@@ -359,7 +809,7 @@ namespace merkle {
         }
 
 
-        friend std::ostream& operator<<(std::ostream& os, FixedSizeTree<Hasher, LEAFS_N, Hash, Concatenator>& tree) {
+        friend std::ostream& operator<<(std::ostream& os, FixedSizeTree<Hasher, LEAFS_N, Hash, Concatenator, Instrumentation>& tree) {
             os << "Merkle tree:\n";
             for(auto i = 0;i <= tree.height();++i) {
                 auto [ldata, lsz] = tree.get_layer(tree.height() - i);
@@ -373,6 +823,270 @@ namespace merkle {
     };
 
 
+    /**
+     * @brief Merkle tree that only grows by appending leaves, with consistency proofs between its versions
+     * @details
+     * Unlike FixedSizeTree, the last node of an odd-sized layer is not copied: the tree over n leaves is split into
+     * the complete left subtree of the largest power of two less than n leaves and the rest (like in RFC 6962).
+     * Thanks to that, appending leaves never changes existing complete subtrees, and any older root can be
+     * shown to be a prefix of a newer one with O(logN) hashes.
+     * The hashes of all complete subtrees are stored, so roots of any version and proofs cost O(logN).
+     * @tparam Hasher type of hash function
+     */
+    template<typename Hasher, typename Hash = Hasher::value_type, typename Concatenator = bconcat::UnifiedConcatenator,
+             typename Instrumentation = NoInstrumentation>
+    class AppendOnlyTree : public TreeBase<AppendOnlyTree<Hasher, Hash, Concatenator, Instrumentation>, Hasher, Concatenator, Instrumentation> {
+
+        using Base = TreeBase<AppendOnlyTree<Hasher, Hash, Concatenator, Instrumentation>, Hasher, Concatenator, Instrumentation>;
+
+        std::vector<std::vector<Hash>> m_levels; ///< m_levels[k][i] is the hash of the complete subtree over leaves [i·2^k, (i+1)·2^k)
+
+
+        /**
+         * @brief hash of the subtree over leaves [lo, hi)
+         * @note O(logN) complexity, complete aligned subtrees are taken from the storage
+         */
+        Hash subtree_hash(const size_t lo, const size_t hi) const {
+            const auto n = hi - lo;
+            if(std::has_single_bit(n) && !(lo & (n - 1)))
+                return m_levels[ilog2(n)][lo >> ilog2(n)];
+
+            const auto k = std::bit_floor(n - 1);
+            return this->node_hash(subtree_hash(lo, lo + k), subtree_hash(lo + k, hi));
+        }
+
+
+        /**
+         * @brief SUBPROOF from RFC 6962 (2.1.2) for the first m leaves of the subtree [lo, hi)
+         */
+        void subproof(const size_t m, const size_t lo, const size_t hi, const bool complete, std::vector<Hash>& proof) const {
+            const auto n = hi - lo;
+            if(m == n) {
+                if(!complete)
+                    proof.push_back(subtree_hash(lo, hi));
+                return;
+            }
+
+            const auto k = std::bit_floor(n - 1);
+            if(m <= k) {
+                subproof(m, lo, lo + k, complete, proof);
+                proof.push_back(subtree_hash(lo + k, hi));
+            } else {
+                subproof(m - k, lo + k, hi, false, proof);
+                proof.push_back(subtree_hash(lo, lo + k));
+            }
+        }
+
+    public:
+        using hash_type = Hash; ///< type of the stored hashes
+
+        template<typename T>
+        AppendOnlyTree(Hasher _h, Concatenator _c, T&& _data) : Base::TreeBase(_h, _c), m_levels(1) {
+            build(std::forward<T>(_data));
+        }
+
+        template<typename T>
+        explicit AppendOnlyTree(T&& _data) : Base::TreeBase(), m_levels(1) {
+            build(std::forward<T>(_data));
+        }
+
+        explicit AppendOnlyTree(Hasher _h, Concatenator _c) : Base::TreeBase(_h, _c), m_levels(1) {}
+        AppendOnlyTree() : Base(), m_levels(1) {}
+
+
+        /**
+         * @brief appends an already calculated leaf hash
+         * @note amortized O(1) complexity
+         */
+        auto& append_leaf_hash(const Hash& lhash) {
+            m_levels[0].push_back(lhash);
+            for(size_t k{};!(m_levels[k].size() & 1);++k) {   // the last subtree of the level got its pair
+                if(k + 1 == m_levels.size())
+                    m_levels.emplace_back();
+
+                auto& level = m_levels[k];
+                m_levels[k + 1].push_back(this->node_hash(level[level.size() - 2], level.back()));
+            }
+
+            return *this;
+        }
+
+
+        /**
+         * @brief appends a leaf to the tree
+         * @param data any data that can be hashed
+         */
+        template<typename... Args>
+        auto& append(Args&&... data) {
+            return append_leaf_hash(this->leaf_hash(std::forward<Args>(data)...));
+        }
+
+
+        /**
+         * @brief appends all elements of a data container as leaves
+         * @return this object
+         */
+        auto& build(auto&& ccont) {
+            for(auto&& x : ccont)
+                append(x);
+
+            return *this;
+        }
+
+
+        /**
+         * @brief root of the tree over the first n leaves (the tree version of size n)
+         * @note the root of the empty tree is the hash of empty input
+         */
+        Hash root_at(const size_t n) const {
+            return n? subtree_hash(0, n) : this->hash(this->concat());
+        }
+
+
+        /**
+         * @brief root of the Merkle tree
+         */
+        Hash root() const {
+            return root_at(get_leafs_n());
+        }
+
+
+        /**
+         * @brief creates a proof of inclusion of a leaf by its index (RFC 6962 audit path)
+         * @param idx index of the leaf
+         * @param n number of leaves in the tree version the proof is created for (the current one by default)
+         * @return sibling hashes from the leaf to the root or an empty list if idx >= n
+         * @note O(logN) complexity
+         */
+        std::vector<Hash> get_proof(size_t idx, size_t n = (size_t)-1) const {
+            n = std::min(n, get_leafs_n());
+            std::vector<Hash> proof{};
+            if(idx >= n)
+                return proof;
+
+            std::vector<std::pair<size_t, size_t>> siblings{};  // collected from the root, stored from the leaf
+            for(size_t lo{}, hi{n};hi - lo > 1;) {
+                const auto k = std::bit_floor(hi - lo - 1);
+                if(idx < lo + k)
+                    siblings.emplace_back(lo + k, hi), hi = lo + k;
+                else siblings.emplace_back(lo, lo + k), lo += k;
+            }
+
+            for(auto it = siblings.rbegin();it != siblings.rend();++it)
+                proof.push_back(subtree_hash(it->first, it->second));
+
+            return proof;
+        }
+
+
+        /**
+         * @brief checks a proof of inclusion created by `get_proof` (RFC 9162, 2.1.3.2)
+         * @details
+         * Does not use the stored leaves, so any object of this tree type (including an empty one) can be a verifier
+         * @param idx index of the leaf
+         * @param n number of leaves in the tree
+         * @param lhash hash of the leaf (see `leaf_hash`)
+         * @param proof audit path
+         * @param root trusted root of the tree of n leaves
+         * @note O(logN) complexity
+         */
+        bool verify_proof(size_t idx, size_t n, const Hash& lhash, const std::vector<Hash>& proof, const Hash& root) const {
+            if(idx >= n)
+                return false;
+
+            auto fn = idx, sn = n - 1;
+            Hash r = lhash;
+            for(auto&& p : proof) {
+                if(!sn)
+                    return false;
+
+                if((fn & 1) || fn == sn) {
+                    r = this->node_hash(p, r);
+                    for(;!(fn & 1) && fn;fn >>= 1, sn >>= 1);
+                }
+                else r = this->node_hash(r, p);
+
+                fn >>= 1, sn >>= 1;
+            }
+
+            return !sn && r == root;
+        }
+
+
+        /**
+         * @brief creates a proof that the tree of n2 leaves extends the tree of its first n1 leaves
+         * @return list of hashes (RFC 6962 consistency proof) or an empty list if 0 < n1 <= n2 <= size does not hold
+         * @note O(logN) complexity, the proof contains at most about 2·logN hashes
+         */
+        std::vector<Hash> get_consistency_proof(const size_t n1, size_t n2 = (size_t)-1) const {
+            n2 = std::min(n2, get_leafs_n());
+            std::vector<Hash> proof{};
+            if(n1 && n1 < n2)
+                subproof(n1, 0, n2, true, proof);
+
+            return proof;
+        }
+
+
+        /**
+         * @brief checks a consistency proof between two roots (RFC 9162, 2.1.4.2)
+         * @details
+         * Does not use the stored leaves, so any object of this tree type (including an empty one) can be a verifier
+         * @param n1 number of leaves in the older tree
+         * @param n2 number of leaves in the newer tree
+         * @param old_root root of the older tree
+         * @param new_root root of the newer tree
+         * @param proof proof created by `get_consistency_proof(n1, n2)`
+         * @note O(logN) complexity
+         */
+        bool verify_consistency(size_t n1, size_t n2, const Hash& old_root, const Hash& new_root, const std::vector<Hash>& proof) const {
+            if(n1 == n2)
+                return proof.empty() && old_root == new_root;
+            if(!n1 || n1 > n2 || proof.empty())
+                return false;
+
+            std::vector<Hash> path{};
+            if(std::has_single_bit(n1))
+                path.push_back(old_root);
+            path.insert(path.end(), proof.begin(), proof.end());
+
+            auto fn = n1 - 1, sn = n2 - 1;
+            for(;fn & 1;fn >>= 1, sn >>= 1);
+
+            Hash fr = path[0], sr = path[0];
+            for(size_t i = 1;i < path.size();++i, fn >>= 1, sn >>= 1) {
+                if(!sn)
+                    return false;
+
+                if((fn & 1) || fn == sn) {
+                    fr = this->node_hash(path[i], fr);
+                    sr = this->node_hash(path[i], sr);
+                    for(;!(fn & 1) && fn;fn >>= 1, sn >>= 1);
+                }
+                else sr = this->node_hash(sr, path[i]);
+            }
+
+            return !sn && fr == old_root && sr == new_root;
+        }
+
+
+        /**
+         * @brief current num of leaves in the tree
+         */
+        size_t get_leafs_n() const {
+            return m_levels[0].size();
+        }
+
+
+        /**
+         * @brief returns a pointer to the leaf hashes
+         */
+        auto data() const {
+            return m_levels[0].data();
+        }
+    };
+
+
     // TODO: Dymamic resizeble tree
 
 };
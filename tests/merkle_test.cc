@@ -11,9 +11,28 @@
 #include "doctest.h"
 
 #include "merkle.hpp"
+#include "merkle_async.hpp"
+#include "merkle_cache.hpp"
+#include "merkle_cdc.hpp"
+#include "merkle_concurrent.hpp"
+#include "merkle_fs.hpp"
+#include "merkle_numa.hpp"
+#include "merkle_soa.hpp"
+#include "merkle_uring.hpp"
 #include <algorithm>
 #include <array>
+#include <atomic>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <list>
+#include <mutex>
+#include <ranges>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <vector>
 
 
@@ -33,9 +52,6 @@ std::ostream& operator<<(std::ostream& os, const std::array<T, N>& arr) {
 
 namespace fs_tree_tests {
 
-TEST_SUITE("MerkleTree fixed size (FS) implementation tests") {
-
-
     struct Hasher {
         using value_type = typename std::array<char, 8>;
         constexpr auto operator()(auto&& cont) const -> value_type  {
@@ -54,6 +70,9 @@ TEST_SUITE("MerkleTree fixed size (FS) implementation tests") {
     }
 
 
+TEST_SUITE("MerkleTree fixed size (FS) implementation tests") {
+
+
     TEST_CASE("[build] single node") {
         FixedSizeTree<Hasher, 1> tree(std::vector<std::string>{"one"});
 
@@ -140,4 +159,1360 @@ TEST_SUITE("MerkleTree fixed size (FS) implementation tests") {
         }
     }
 
+
+    TEST_CASE("[proof] verify proof from get_proof") {
+        std::vector<std::string> d = {"first", "second", "third", "fourth", "fifth"};
+        FixedSizeTree<Hasher, 5> tree(d);
+
+        for(auto&& s : d)
+            REQUIRE(tree.verify_proof(s, tree.get_proof(s).second));
+
+        REQUIRE_FALSE(tree.verify_proof((std::string)"sixth", tree.get_proof(d[0]).second));
+    }
+
+}
+
+
+TEST_SUITE("Compact proof serialization tests") {
+
+    TEST_CASE("[compact] layout and zero-copy view") {
+        std::vector<std::string> d = {"first", "second", "third", "fourth", "fifth"};
+        FixedSizeTree<Hasher, 5> tree(d);
+
+        for(size_t i{};i < d.size();++i) {
+            auto bytes = tree.get_compact_proof(d[i]);
+            REQUIRE(bytes.size() == compact_proof::size<Hasher::value_type>(tree.height(), true));
+
+            ProofView<Hasher::value_type> view(bytes.data(), bytes.size());
+            REQUIRE(view.valid());
+            REQUIRE(view.has_root());
+            REQUIRE(view.height() == 3);
+            REQUIRE(view.leaf_index() == i);
+            REQUIRE(view.root() == tree.root());
+
+            auto [initial, proof] = tree.get_proof(d[i]);
+            for(size_t j{};j < view.height();++j) {
+                REQUIRE(view.sibling(j) == proof[j].first);
+                REQUIRE(view.direction(j) == proof[j].second);
+            }
+
+            REQUIRE(tree.verify_proof(d[i], view));
+            REQUIRE_FALSE(tree.verify_proof(d[(i + 1) % d.size()], view));
+        }
+    }
+
+
+    TEST_CASE("[compact] omitted root") {
+        std::vector<std::string> d = {"lhs", "rhs"};
+        FixedSizeTree<Hasher, 2> tree(d);
+
+        auto bytes = tree.get_compact_proof(d[1], false);
+        REQUIRE(bytes.size() == 3 + sizeof(Hasher::value_type));
+
+        ProofView<Hasher::value_type> view(bytes.data(), bytes.size());
+        REQUIRE(view.valid());
+        REQUIRE_FALSE(view.has_root());
+        REQUIRE_FALSE(tree.verify_proof(d[1], view));  // nothing to compare with
+        REQUIRE(tree.verify_proof(d[1], view, tree.root()));
+        REQUIRE_FALSE(tree.verify_proof(d[1], view, Hasher::value_type{}));
+    }
+
+
+    TEST_CASE("[compact] malformed and unknown input") {
+        std::vector<std::string> d = {"first", "second", "third"};
+        FixedSizeTree<Hasher, 3> tree(d);
+
+        REQUIRE(tree.get_compact_proof((std::string)"fourth").empty());
+
+        auto bytes = tree.get_compact_proof(d[2]);
+        REQUIRE_FALSE(ProofView<Hasher::value_type>(bytes.data(), bytes.size() - 1).valid());
+
+        bytes[2] |= 0x80;   // direction bit above the height
+        REQUIRE_FALSE(ProofView<Hasher::value_type>(bytes.data(), bytes.size()).valid());
+        bytes[2] &= 0x7f;
+        REQUIRE(ProofView<Hasher::value_type>(bytes.data(), bytes.size()).valid());
+
+        bytes[bytes.size() / 2] ^= 1;   // corrupt a sibling
+        REQUIRE_FALSE(tree.verify_proof(d[2], ProofView<Hasher::value_type>(bytes.data(), bytes.size())));
+    }
+
+}
+
+
+TEST_SUITE("Tree diff tests") {
+
+    template<size_t N>
+    auto make_leaves(std::initializer_list<size_t> changed = {}) {
+        std::vector<std::string> d{};
+        for(size_t i{};i < N;++i)
+            d.push_back("leaf" + std::to_string(i));
+        for(auto i : changed)
+            d[i] += "*";
+
+        return d;
+    }
+
+
+    TEST_CASE("[diff] identical trees") {
+        FixedSizeTree<Hasher, 37> lhs(make_leaves<37>()), rhs(make_leaves<37>());
+        REQUIRE(diff(lhs, rhs).empty());
+    }
+
+
+    TEST_CASE("[diff] differing leaves are grouped into ranges") {
+        FixedSizeTree<Hasher, 37> lhs(make_leaves<37>()), rhs(make_leaves<37>({0, 1, 2, 17, 35, 36}));
+        REQUIRE(diff(lhs, rhs) == LeafRanges{{0, 3}, {17, 18}, {35, 37}});
+        REQUIRE(diff(rhs, lhs) == LeafRanges{{0, 3}, {17, 18}, {35, 37}});
+    }
+
+
+    TEST_CASE("[diff] single leaf and odd tails") {
+        FixedSizeTree<Hasher, 1> a(make_leaves<1>()), b(make_leaves<1>({0}));
+        REQUIRE(diff(a, b) == LeafRanges{{0, 1}});
+
+        FixedSizeTree<Hasher, 5> c(make_leaves<5>()), e(make_leaves<5>({4}));
+        REQUIRE(diff(c, e) == LeafRanges{{4, 5}});
+    }
+
+
+    TEST_CASE("[diff] remote source traffic scales with differences") {
+        FixedSizeTree<Hasher, 1000> local(make_leaves<1000>()), remote(make_leaves<1000>({123}));
+
+        size_t calls{}, transferred{};
+        auto ranges = diff(local, [&](size_t layer, size_t begin, size_t end) {
+            ++calls, transferred += end - begin;
+            auto [ldata, lsz] = remote.get_layer(layer);
+            return std::vector<Hasher::value_type>(ldata + begin, ldata + end);
+        });
+
+        REQUIRE(ranges == LeafRanges{{123, 124}});
+        REQUIRE(calls == local.height() + 1);
+        REQUIRE(transferred == 2 * local.height() + 1);
+    }
+
+}
+
+
+TEST_SUITE("Range proof tests") {
+
+    template<size_t N>
+    void check_all_ranges() {
+        std::vector<std::string> d{};
+        for(size_t i{};i < N;++i)
+            d.push_back("leaf" + std::to_string(i));
+
+        FixedSizeTree<Hasher, N> tree(d);
+        for(size_t a{};a < N;++a)
+            for(size_t b = a + 1;b <= N;++b) {
+                auto proof = tree.get_range_proof(a, b);
+                REQUIRE(proof.hashes.size() <= 2 * tree.height());
+
+                std::vector<std::string> run(d.begin() + a, d.begin() + b);
+                REQUIRE(tree.verify_range_proof(run, proof, tree.root()));
+
+                run.back() += "*";
+                REQUIRE_FALSE(tree.verify_range_proof(run, proof, tree.root()));
+            }
+    }
+
+
+    TEST_CASE("[range] every range of small trees") {
+        check_all_ranges<1>();
+        check_all_ranges<2>();
+        check_all_ranges<5>();
+        check_all_ranges<7>();
+        check_all_ranges<16>();
+        check_all_ranges<21>();
+    }
+
+
+    TEST_CASE("[range] inconsistent input") {
+        std::vector<std::string> d = {"first", "second", "third", "fourth", "fifth"};
+        FixedSizeTree<Hasher, 5> tree(d);
+
+        REQUIRE(tree.get_range_proof(3, 3).hashes.empty());
+        REQUIRE(tree.get_range_proof(2, 6).last == 0);
+
+        auto proof = tree.get_range_proof(1, 3);
+        REQUIRE_FALSE(tree.verify_range_proof(std::vector<std::string>{"second"}, proof, tree.root()));
+
+        proof.hashes.pop_back();
+        REQUIRE_FALSE(tree.verify_range_proof(std::vector<std::string>{"second", "third"}, proof, tree.root()));
+    }
+
+}
+
+
+TEST_SUITE("Append-only tree consistency proof tests") {
+
+    auto make_tree(size_t n) {
+        AppendOnlyTree<Hasher> tree{};
+        for(size_t i{};i < n;++i)
+            tree.append("leaf" + std::to_string(i));
+
+        return tree;
+    }
+
+
+    TEST_CASE("[append] roots of the RFC 6962 shape") {
+        auto tree = make_tree(3);
+        auto lh{[&](auto&& x){ return tree.leaf_hash(x); }};
+        auto nh{[&](auto&& x){ return tree.node_hash(x); }};
+
+        auto l = std::vector<Hasher::value_type>{lh((std::string)"leaf0"), lh((std::string)"leaf1"), lh((std::string)"leaf2")};
+        auto lhs = nh(l[0] + l[1]);
+        REQUIRE(tree.root() == nh(lhs + l[2]));   // the odd leaf is not copied
+        REQUIRE(tree.root_at(1) == l[0]);
+        REQUIRE(tree.root_at(2) == nh(l[0] + l[1]));
+        REQUIRE(tree.has((std::string)"leaf2"));
+    }
+
+
+    TEST_CASE("[append] power of two sizes match the fixed size tree") {
+        std::vector<std::string> d{};
+        for(size_t i{};i < 8;++i)
+            d.push_back("leaf" + std::to_string(i));
+
+        REQUIRE(AppendOnlyTree<Hasher>(d).root() == FixedSizeTree<Hasher, 8>(d).root());
+    }
+
+
+    TEST_CASE("[consistency] every pair of versions") {
+        constexpr size_t N = 40;
+        auto tree = make_tree(N);
+        AppendOnlyTree<Hasher> verifier{};
+
+        for(size_t n2 = 1;n2 <= N;++n2)
+            for(size_t n1 = 1;n1 <= n2;++n1) {
+                auto proof = tree.get_consistency_proof(n1, n2);
+                REQUIRE(proof.size() <= 2 * AppendOnlyTree<Hasher>::height(n2));
+                REQUIRE(verifier.verify_consistency(n1, n2, tree.root_at(n1), tree.root_at(n2), proof));
+
+                if(n1 < n2) {
+                    REQUIRE_FALSE(verifier.verify_consistency(n1, n2, make_tree(n1 + 1).root_at(n1 - 1), tree.root_at(n2), proof));
+                    REQUIRE_FALSE(verifier.verify_consistency(n1, n2, tree.root_at(n1), tree.root_at(n2 - 1), proof));
+                }
+            }
+    }
+
+
+    TEST_CASE("[consistency] rewritten history is rejected") {
+        auto tree = make_tree(13);
+        auto forged = make_tree(5);
+        forged.append((std::string)"forged");
+        for(size_t i = 6;i < 13;++i)
+            forged.append("leaf" + std::to_string(i));
+
+        auto proof = forged.get_consistency_proof(7, 13);
+        REQUIRE_FALSE(tree.verify_consistency(7, 13, tree.root_at(7), forged.root(), proof));
+        REQUIRE(tree.get_consistency_proof(0, 13).empty());
+        REQUIRE(tree.get_consistency_proof(14).empty());
+    }
+
+}
+
+
+TEST_SUITE("Compile-time tree construction tests") {
+
+    constexpr auto sha256_hex(std::string_view s) {
+        std::array<char, 64> hex{};
+        auto digest = Sha256{}(s);
+        for(size_t i{};i < digest.size();++i)
+            hex[2 * i] = "0123456789abcdef"[digest[i] >> 4], hex[2 * i + 1] = "0123456789abcdef"[digest[i] & 15];
+
+        return std::string_view(hex.data(), hex.size()) == std::string_view(
+            s.empty()? "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"
+                     : "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+    }
+
+    static_assert(sha256_hex(""));
+    static_assert(sha256_hex("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"));
+
+
+    constexpr std::array<std::string_view, 5> manifest = {"boot.bin", "kernel.img", "rootfs.img", "dtb.bin", "env.txt"};
+    constexpr FixedSizeTree<Sha256, 5> static_tree(manifest);
+
+
+    TEST_CASE("[constexpr] root and proofs are calculated at compile time") {
+        static_assert(static_tree.verify(manifest[3]));
+        static_assert(!static_tree.verify(std::string_view("initrd.img")));
+        static_assert(static_tree.verify_proof(manifest[1], static_tree.get_proof(manifest[1]).second));
+
+        FixedSizeTree<Sha256, 5> runtime_tree(std::vector<std::string>(manifest.begin(), manifest.end()));
+        REQUIRE(static_tree.root() == runtime_tree.root());
+    }
+
+
+    TEST_CASE("[constexpr] trivial concatenator") {
+        constexpr auto bytes = bconcat::TrivialConcatenator::concat(uint32_t{0x01020304}, std::array<char, 2>{'a', 'b'});
+        static_assert(bytes.size() == 6 && bytes[4] == 'a' && bytes[5] == 'b');
+
+        constexpr FixedSizeTree<Fnv1a, 3, uint64_t, bconcat::TrivialConcatenator> tree(std::array<uint64_t, 3>{1, 2, 3});
+        FixedSizeTree<Fnv1a, 3, uint64_t, bconcat::TrivialConcatenator> runtime_tree(std::vector<uint64_t>{1, 2, 3});
+        REQUIRE(tree.root() == runtime_tree.root());
+        REQUIRE(tree.root() != decltype(runtime_tree)(std::vector<uint64_t>{1, 2, 4}).root());
+    }
+
+}
+
+
+TEST_SUITE("Instrumentation tests") {
+
+    TEST_CASE("[instrumentation] default policy is free") {
+        REQUIRE(sizeof(FixedSizeTree<Hasher, 5>) == sizeof(std::array<Hasher::value_type, calc_tree_size(5)>));
+        REQUIRE(FixedSizeTree<Hasher, 2>(std::vector<std::string>{"lhs", "rhs"}).stats().hashes() == 0);
+    }
+
+
+    TEST_CASE("[instrumentation] build and proof costs") {
+        std::vector<std::string> d = {"first", "second", "third", "fourth", "fifth"};
+        FixedSizeTree<Hasher, 5, Hasher::value_type, bconcat::UnifiedConcatenator, CountingInstrumentation> tree(d);
+
+        auto built = tree.stats();
+        REQUIRE(built.leaf_hashes == 5);
+        REQUIRE(built.node_hashes == 3 + 2 + 1);
+        REQUIRE(built.concat_allocs == 11);
+        REQUIRE(built.hashed_bytes == (4 * 5 + 5 + 6 + 5 + 6 + 5) + 6 * (4 + 2 * sizeof(Hasher::value_type)));
+
+        tree.get_proof(d[3]);
+        auto proof = tree.stats() - built;
+        REQUIRE(proof.leaf_hashes == 1);
+        REQUIRE(proof.node_hashes == 0);
+
+        tree.reset_stats();
+        REQUIRE(tree.stats().hashes() == 0);
+
+        tree.build(d);
+        REQUIRE(tree.stats().hashes() == built.hashes());
+    }
+
+
+    TEST_CASE("[instrumentation] append-only tree") {
+        AppendOnlyTree<Hasher, Hasher::value_type, bconcat::UnifiedConcatenator, CountingInstrumentation> tree{};
+        for(size_t i{};i < 8;++i)
+            tree.append(std::to_string(i));
+
+        REQUIRE(tree.stats().leaf_hashes == 8);
+        REQUIRE(tree.stats().node_hashes == 7);
+    }
+
+}
+
+
+TEST_SUITE("Directory tree builder tests") {
+
+    TEST_CASE("[fs] file leaves in path order") {
+        auto dir = std::filesystem::temp_directory_path() / "merkle_fs_test";
+        std::filesystem::remove_all(dir);
+        std::filesystem::create_directories(dir / "sub");
+
+        std::vector<std::pair<std::string, std::string>> files = {
+            {"a.txt", "first"}, {"b.bin", std::string(100000, 'x')}, {"sub/c.txt", ""}, {"sub/d.txt", "fourth"}
+        };
+        for(auto&& [name, content] : files)
+            std::ofstream(dir / name, std::ios::binary) << content;
+
+        AppendOnlyTree<Hasher> expected{};
+        for(auto&& [name, content] : files)
+            expected.append(uint64_t{name.size()}, name, content);
+
+        for(size_t workers : {1, 3}) {
+            AppendOnlyTree<Hasher> tree{};
+            auto stats = FileTreeBuilder(tree, {.workers = workers, .queue_depth = 1, .mmap_threshold = 4096}).build(dir);
+
+            REQUIRE(stats.files == files.size());
+            REQUIRE(stats.errors == 0);
+            REQUIRE(stats.bytes == 5 + 100000 + 6);
+            REQUIRE(tree.root() == expected.root());
+        }
+
+        AppendOnlyTree<Sha256> sha_expected{};
+        for(auto&& [name, content] : files)
+            sha_expected.append(uint64_t{name.size()}, name, content);
+
+        AppendOnlyTree<Sha256, Sha256::value_type, bconcat::UnifiedConcatenator, CountingInstrumentation> sha_tree{};
+        FileTreeBuilder(sha_tree, {.workers = 2, .mmap_threshold = 4096}).build(dir);
+        REQUIRE(sha_tree.root() == sha_expected.root());
+        REQUIRE(sha_tree.stats().leaf_hashes == files.size());
+        REQUIRE(sha_tree.stats().concat_allocs == sha_tree.stats().node_hashes);  // file contents are not copied
+
+        std::filesystem::remove_all(dir);
+    }
+
+}
+
+
+TEST_SUITE("Chunked blob builder tests") {
+
+    TEST_CASE("[chunks] leaves and chunk proofs") {
+        auto path = std::filesystem::temp_directory_path() / "merkle_blob_test.bin";
+        std::string blob(10 * 4096 + 123, '\0');
+        for(size_t i{};i < blob.size();++i)
+            blob[i] = static_cast<char>(i * 131 + (i >> 7));
+        std::ofstream(path, std::ios::binary) << blob;
+
+        AppendOnlyTree<Sha256> expected{};
+        for(size_t off{};off < blob.size();off += 4096)
+            expected.append(std::string_view(blob).substr(off, 4096));
+
+        for(size_t workers : {1, 4}) {
+            AppendOnlyTree<Sha256> tree{};
+            auto stats = ChunkedBlobBuilder(tree, {.chunk_size = 4096, .workers = workers, .buffers = 3}).build(path);
+
+            REQUIRE(stats);
+            REQUIRE_FALSE(stats->error);
+            REQUIRE(stats->chunks == 11);
+            REQUIRE(stats->bytes == blob.size());
+            REQUIRE(tree.root() == expected.root());
+
+            for(size_t i{};i < stats->chunks;++i) {
+                auto chunk = std::string_view(blob).substr(i * 4096, 4096);
+                auto proof = tree.get_proof(i);
+                REQUIRE(tree.verify_proof(i, tree.get_leafs_n(), tree.leaf_hash(chunk), proof, tree.root()));
+                REQUIRE_FALSE(tree.verify_proof(i ^ 1, tree.get_leafs_n(), tree.leaf_hash(chunk), proof, tree.root()));
+            }
+        }
+
+        REQUIRE_FALSE(ChunkedBlobBuilder(expected).build(path.string() + ".missing"));
+        std::filesystem::remove(path);
+    }
+
+
+    TEST_CASE("[chunks] inclusion proofs of every leaf and tree version") {
+        AppendOnlyTree<Hasher> tree{};
+        for(size_t i{};i < 20;++i)
+            tree.append(std::to_string(i));
+
+        for(size_t n = 1;n <= 20;++n)
+            for(size_t i{};i < n;++i) {
+                auto proof = tree.get_proof(i, n);
+                REQUIRE(proof.size() <= AppendOnlyTree<Hasher>::height(n));
+                REQUIRE(tree.verify_proof(i, n, tree.leaf_hash(std::to_string(i)), proof, tree.root_at(n)));
+                REQUIRE_FALSE(tree.verify_proof(i, n, tree.leaf_hash(std::to_string(i + 1)), proof, tree.root_at(n)));
+            }
+
+        REQUIRE(tree.get_proof(20).empty());
+    }
+
+}
+
+
+TEST_SUITE("Content-defined chunking tests") {
+
+    std::string random_blob(size_t n, uint64_t seed) {
+        std::string blob(n, '\0');
+        for(auto&& c : blob)
+            c = static_cast<char>((seed ^= seed << 13, seed ^= seed >> 7, seed ^= seed << 17));
+
+        return blob;
+    }
+
+
+    TEST_CASE("[cdc] chunk sizes and coverage") {
+        auto blob = random_blob(1 << 20, 42);
+        FastCdc cdc({.min_size = 1024, .avg_size = 4096, .max_size = 16384});
+        auto chunks = cdc.chunks(blob);
+
+        size_t total{};
+        for(size_t i{};i < chunks.size();++i) {
+            REQUIRE(chunks[i].data() == blob.data() + total);
+            REQUIRE(chunks[i].size() <= 16384);
+            if(i + 1 < chunks.size())
+                REQUIRE(chunks[i].size() >= 1024);
+            total += chunks[i].size();
+        }
+
+        REQUIRE(total == blob.size());
+        REQUIRE(chunks.size() > (1 << 20) / 8192);   // close to the average size
+        REQUIRE(chunks.size() < (1 << 20) / 2048);
+        REQUIRE(cdc.chunks(blob).size() == chunks.size());
+
+        std::string zeros(100000, '\0');   // no content-defined cut points, max-size chunks
+        REQUIRE(cdc.chunks(zeros).size() == (100000 + 16383) / 16384);
+        REQUIRE(cdc.chunks(std::string_view{}).empty());
+    }
+
+
+    TEST_CASE("[cdc] insertion changes only nearby leaves") {
+        auto blob = random_blob(1 << 20, 7);
+        auto edited = blob;
+        edited.insert(edited.begin() + 300000, 'x');
+
+        FastCdc cdc{};
+        AppendOnlyTree<Sha256> lhs{}, rhs{};
+        auto lhs_n = cdc.append(lhs, blob), rhs_n = cdc.append(rhs, edited);
+        REQUIRE(lhs_n == lhs.get_leafs_n());
+
+        size_t shared{};
+        for(size_t i{};i < rhs_n;++i)
+            shared += std::find(lhs.data(), lhs.data() + lhs_n, rhs.data()[i]) != lhs.data() + lhs_n;
+
+        REQUIRE(rhs_n >= lhs_n);
+        REQUIRE(shared + 3 >= lhs_n);
+
+        AppendOnlyTree<Sha256> fixed{};   // fixed-size chunks after the insertion are all different
+        for(size_t off{};off < edited.size();off += 8192)
+            fixed.append(std::string_view(edited).substr(off, 8192));
+        REQUIRE(fixed.root() != rhs.root());
+    }
+
+}
+
+
+TEST_SUITE("Asynchronous reader tests") {
+
+    template<typename Reader>
+    void check_reader(Reader& reader) {
+        auto dir = std::filesystem::temp_directory_path() / "merkle_reader_test";
+        std::filesystem::remove_all(dir);
+        std::filesystem::create_directories(dir);
+
+        std::string blob(5 * 4096 + 7, '\0');
+        for(size_t i{};i < blob.size();++i)
+            blob[i] = static_cast<char>(i * 7 + (i >> 9));
+
+        std::vector<std::pair<std::string, std::string>> files{{"big.bin", std::string(10000, 'y')}, {"empty", ""}};
+        for(size_t i{};i < 10;++i)
+            files.emplace_back("f" + std::to_string(i), std::string(i * 300, static_cast<char>('a' + i)));
+        std::sort(files.begin(), files.end());
+        for(auto&& [name, content] : files)
+            std::ofstream(dir / name, std::ios::binary) << content;
+
+        AppendOnlyTree<Hasher> expected{}, tree{};
+        for(auto&& [name, content] : files)
+            expected.append(uint64_t{name.size()}, name, content);
+
+        auto stats = FileTreeBuilder(tree, {.workers = 2}).build(dir, reader);
+        REQUIRE(stats.files == files.size());
+        REQUIRE(stats.errors == 0);
+        REQUIRE(tree.root() == expected.root());
+
+        AppendOnlyTree<Sha256> sha_expected{}, sha_tree{};
+        for(auto&& [name, content] : files)
+            sha_expected.append(uint64_t{name.size()}, name, content);
+        FileTreeBuilder(sha_tree, {.workers = 2}).build(dir, reader);
+        REQUIRE(sha_tree.root() == sha_expected.root());
+
+        std::ofstream(dir / "blob", std::ios::binary) << blob;
+        AppendOnlyTree<Sha256> blob_expected{}, blob_tree{};
+        ChunkedBlobBuilder(blob_expected, {.chunk_size = 4096, .workers = 1}).build(dir / "blob");
+
+        auto blob_stats = ChunkedBlobBuilder(blob_tree, {.chunk_size = 4096, .workers = 3}).build(dir / "blob", reader);
+        REQUIRE(blob_stats);
+        REQUIRE_FALSE(blob_stats->error);
+        REQUIRE(blob_stats->chunks == 6);
+        REQUIRE(blob_stats->bytes == blob.size());
+        REQUIRE(blob_tree.root() == blob_expected.root());
+
+        REQUIRE_FALSE(ChunkedBlobBuilder(blob_tree, {.chunk_size = 8192}).build(dir / "blob", reader));
+        REQUIRE_FALSE(ChunkedBlobBuilder(blob_tree, {.chunk_size = 4096}).build(dir / "missing", reader));
+
+        std::filesystem::remove_all(dir);
+    }
+
+
+    TEST_CASE("[io] pread thread pool") {
+        PreadReader reader({.buffers = 3, .buffer_size = 4096, .threads = 2});
+        check_reader(reader);
+    }
+
+
+    TEST_CASE("[io] io_uring") {
+        UringReader reader({.buffers = 3, .buffer_size = 4096});
+        if(!reader.valid())
+            return;   // not supported by the system
+
+        check_reader(reader);
+    }
+
+}
+
+
+TEST_SUITE("Parallel build tests") {
+
+    template<size_t N>
+    void check_parallel_build(const size_t subtree_leaves, const size_t workers) {
+        std::vector<std::string> leaves(N);
+        for(size_t i{};i < N;++i)
+            leaves[i] = std::to_string(i * 7919);
+
+        auto expected = std::make_unique<FixedSizeTree<Hasher, N>>(), tree = std::make_unique<FixedSizeTree<Hasher, N>>();
+        expected->build(leaves);
+        build_parallel(*tree, leaves, {.workers = workers, .subtree_leaves = subtree_leaves});
+
+        for(size_t l{};l <= tree->height();++l) {
+            auto [lhs, n] = tree->get_layer(l);
+            auto rhs = expected->get_layer(l).first;
+            REQUIRE(std::equal(lhs, lhs + n, rhs));
+        }
+    }
+
+
+    TEST_CASE("[parallel] same layers as the serial build") {
+        for(size_t workers : {1, 2, 5})
+            for(size_t sub : {0, 2, 8, 64}) {
+                check_parallel_build<1>(sub, workers);
+                check_parallel_build<2>(sub, workers);
+                check_parallel_build<7>(sub, workers);
+                check_parallel_build<64>(sub, workers);
+                check_parallel_build<1000>(sub, workers);
+                check_parallel_build<1025>(sub, workers);
+                check_parallel_build<4099>(sub, workers);
+            }
+    }
+
+
+    TEST_CASE("[parallel] work stealing runs every task once") {
+        for(size_t workers : {1, 3, 8})
+            for(size_t n : {0, 1, 5, 1000}) {
+                std::vector<std::atomic<int>> runs(n);
+                work_stealing_for(n, workers, [&](size_t i) {
+                    if(i % 3 == 0)  // uneven tasks
+                        std::this_thread::sleep_for(std::chrono::microseconds(50));
+                    runs[i].fetch_add(1);
+                });
+                REQUIRE(std::all_of(runs.begin(), runs.end(), [](auto& r) { return r == 1; }));
+            }
+    }
+
+}
+
+
+TEST_SUITE("Executor tests") {
+
+    TEST_CASE("[executor] parallel operations on shared executors") {
+        constexpr size_t N = 777;
+        std::vector<std::string> leaves(N);
+        for(size_t i{};i < N;++i)
+            leaves[i] = std::to_string(i * 31);
+
+        FixedSizeTree<Hasher, N> expected{};
+        expected.build(leaves);
+
+        std::deque<std::function<void()>> user_queue{};  // user pool running the tasks later on its own thread
+        std::mutex user_mtx;
+        ExecutorAdapter adapter([&](auto task) { std::lock_guard lock(user_mtx); user_queue.push_back(std::move(task)); }, 2);
+
+        InlineExecutor inline_ex{};
+        ThreadPool pool(3);
+        auto check = [&](auto& ex) {
+            FixedSizeTree<Hasher, N> tree{};
+            build_parallel(tree, leaves, ex, {.subtree_leaves = 16});
+            REQUIRE(tree.root() == expected.root());
+
+            auto proofs = get_proofs(tree, leaves, ex);
+            REQUIRE(proofs.size() == N);
+            REQUIRE(proofs[123] == expected.get_proof(leaves[123]));
+
+            std::vector<decltype(proofs[0].second)> paths{};
+            for(auto&& p : proofs)
+                paths.push_back(p.second);
+            auto ok = verify_proofs(tree, leaves, paths, ex);
+            REQUIRE(std::all_of(ok.begin(), ok.end(), [](char c) { return c == 1; }));
+
+            std::swap(paths[0], paths[1]);
+            REQUIRE_FALSE(verify_proofs(tree, leaves, paths, ex)[0]);
+        };
+
+        check(inline_ex);
+        check(pool);
+        check(adapter);   // the caller does all the work, the late tasks are skipped
+
+        REQUIRE(!user_queue.empty());
+        for(auto&& task : user_queue)
+            task();
+    }
+
+
+    TEST_CASE("[executor] builders on a shared pool") {
+        auto dir = std::filesystem::temp_directory_path() / "merkle_executor_test";
+        std::filesystem::remove_all(dir);
+        std::filesystem::create_directories(dir);
+
+        std::string blob(20000, '\0');
+        for(size_t i{};i < blob.size();++i)
+            blob[i] = static_cast<char>(i % 251);
+        for(size_t i{};i < 20;++i)
+            std::ofstream(dir / std::to_string(i), std::ios::binary) << blob.substr(0, i * 1000);
+
+        AppendOnlyTree<Hasher> expected{};
+        FileTreeBuilder(expected, {.workers = 1}).build(dir);
+
+        InlineExecutor inline_ex{};
+        ThreadPool pool(2);
+        PreadReader reader({.buffers = 2, .buffer_size = 8192});
+        for(ExecutorRef ex : {ExecutorRef(inline_ex), ExecutorRef(pool)}) {
+            AppendOnlyTree<Hasher> files{}, files_read{};
+            FileTreeBuilder(files, ex, {.workers = 4, .queue_depth = 1}).build(dir);
+            FileTreeBuilder(files_read, ex, {.workers = 4, .queue_depth = 1}).build(dir, reader);
+            REQUIRE(files.root() == expected.root());
+            REQUIRE(files_read.root() == expected.root());
+
+            AppendOnlyTree<Hasher> chunks{}, chunks_expected{};
+            auto stats = ChunkedBlobBuilder(chunks, ex, {.chunk_size = 4096, .buffers = 2}).build(dir / "19");
+            ChunkedBlobBuilder(chunks_expected, {.chunk_size = 4096}).build(dir / "19");
+            REQUIRE(stats);
+            REQUIRE(stats->chunks == 5);
+            REQUIRE(chunks.root() == chunks_expected.root());
+        }
+
+        std::filesystem::remove_all(dir);
+    }
+
+}
+
+
+TEST_SUITE("Coroutine API tests") {
+
+    /**
+     * @brief single-threaded event loop run by the test itself
+     */
+    struct EventLoop {
+        std::deque<std::function<void()>> tasks{};
+
+        void execute(std::function<void()> f) {
+            tasks.push_back(std::move(f));
+        }
+
+        size_t concurrency() const {
+            return 0;   // the tasks run on the thread calling `run`
+        }
+
+        size_t run() {
+            size_t n{};
+            for(;!tasks.empty();++n) {
+                auto task = std::move(tasks.front());
+                tasks.pop_front();
+                task();
+            }
+            return n;
+        }
+    };
+
+
+    TEST_CASE("[async] update recalculates the path") {
+        std::vector<std::string> leaves{"a", "b", "c", "d", "e", "f", "g"};
+        FixedSizeTree<Hasher, 7> tree(leaves);
+
+        for(size_t i{};i < leaves.size();++i) {
+            leaves[i] += "!";
+            REQUIRE(tree.update(i, leaves[i]));
+            REQUIRE(tree.root() == FixedSizeTree<Hasher, 7>(leaves).root());
+            REQUIRE(tree.verify_proof(leaves[i], tree.get_proof(leaves[i]).second));
+        }
+
+        REQUIRE_FALSE(tree.update(7, "h"));
+        FixedSizeTree<Hasher, 1> single(std::vector<std::string>{"x"});
+        REQUIRE(single.update(0, std::string("y")));
+        REQUIRE(single.root() == FixedSizeTree<Hasher, 1>(std::vector<std::string>{"y"}).root());
+    }
+
+
+    TEST_CASE("[async] build interleaves with other events") {
+        constexpr size_t N = 1000;
+        std::vector<std::string> leaves(N);
+        for(size_t i{};i < N;++i)
+            leaves[i] = std::to_string(i);
+
+        FixedSizeTree<Hasher, N> expected(leaves), tree{};
+        EventLoop loop{};
+        bool built{};
+        size_t handled_before{};
+        start(build_async(tree, leaves, loop, 100), [&] { built = true; });
+
+        REQUIRE_FALSE(built);   // nothing runs before the loop
+        loop.execute([&] { handled_before += !built; });
+        REQUIRE(loop.run() > 20);
+        REQUIRE(built);
+        REQUIRE(handled_before == 1);
+        REQUIRE(tree.root() == expected.root());
+
+        bool updated{};
+        start(update_async(tree, 5, std::string("five"), loop), [&](bool ok) { updated = ok; });
+        loop.run();
+        REQUIRE(updated);
+        REQUIRE(tree.root() != expected.root());
+    }
+
+
+    TEST_CASE("[async] offloading to a thread pool") {
+        constexpr size_t N = 300;
+        std::vector<std::string> leaves(N);
+        for(size_t i{};i < N;++i)
+            leaves[i] = std::to_string(i * i);
+
+        FixedSizeTree<Hasher, N> expected(leaves), tree{};
+        ThreadPool pool(2);
+        InlineExecutor inline_ex{};
+
+        sync_wait(build_async(tree, leaves, pool, 64));
+        REQUIRE(tree.root() == expected.root());
+
+        auto proofs = sync_wait(get_proofs_async(tree, leaves, pool, 16));
+        REQUIRE(proofs.size() == N);
+        REQUIRE(proofs[N - 1] == expected.get_proof(leaves[N - 1]));
+
+        std::vector<decltype(proofs[0].second)> paths{};
+        for(auto&& p : proofs)
+            paths.push_back(p.second);
+        auto ok = sync_wait(verify_proofs_async(tree, leaves, paths, inline_ex));
+        REQUIRE(std::count(ok.begin(), ok.end(), 1) == N);
+
+        auto chain = [&]() -> Task<bool> {   // awaiting tasks from another coroutine
+            co_await build_async(tree, leaves, pool);
+            co_return co_await update_async(tree, 0, std::string("zero"), pool);
+        };
+        REQUIRE(sync_wait(chain()));
+        REQUIRE(tree.root() != expected.root());
+    }
+
+}
+
+
+TEST_SUITE("Segment concatenator tests") {
+
+    TEST_CASE("[segments] same bytes as unified concatenator") {
+        std::string large(100000, 'x');
+        std::vector<uint16_t> wide = {1, 2, 300};
+        auto segs = bconcat::SegmentConcatenator::concat(0x01, large, wide, uint64_t{7});
+        auto bytes = bconcat::UnifiedConcatenator::concat(0x01, large, wide, uint64_t{7});
+
+        REQUIRE(segs.segments() == 4);
+        REQUIRE(segs.size() == bytes.size());
+        REQUIRE(segs.flatten() == bytes);
+        REQUIRE(std::equal(segs.begin(), segs.end(), bytes.begin(), bytes.end()));
+        REQUIRE(segs.segment(1).data() == large.data());
+        REQUIRE(Sha256{}(segs) == Sha256{}(bytes));
+        REQUIRE(Fnv1a{}(segs) == Fnv1a{}(bytes));
+    }
+
+
+    TEST_CASE("[segments] empty arguments") {
+        std::string empty{}, ab{"ab"};
+        auto segs = bconcat::SegmentConcatenator::concat(empty, ab, empty);
+        REQUIRE(std::string(segs.begin(), segs.end()) == "ab");
+        REQUIRE(Sha256{}(segs) == Sha256{}(std::string("ab")));
+    }
+
+
+    TEST_CASE("[segments] trees have the same roots and proofs") {
+        std::vector<std::string> d = {"first", std::string(5000, 'l'), "third", "fourth", "fifth"};
+        FixedSizeTree<Sha256, 5> tree(d);
+        FixedSizeTree<Sha256, 5, Sha256::value_type, bconcat::SegmentConcatenator> seg_tree(d);
+        FixedSizeTree<Hasher, 5> iter_tree(d);
+        FixedSizeTree<Hasher, 5, Hasher::value_type, bconcat::SegmentConcatenator> seg_iter_tree(d);
+
+        REQUIRE(tree.root() == seg_tree.root());
+        REQUIRE(iter_tree.root() == seg_iter_tree.root());
+        REQUIRE(seg_tree.verify_proof(d[1], seg_tree.get_proof(d[1]).second));
+
+        AppendOnlyTree<Sha256> log{};
+        AppendOnlyTree<Sha256, Sha256::value_type, bconcat::SegmentConcatenator> seg_log{};
+        for(auto&& x : d)
+            log.append(x), seg_log.append(x);
+        REQUIRE(log.root() == seg_log.root());
+    }
+
+
+    TEST_CASE("[segments] leaves are not copied") {
+        std::vector<std::string> d = {"first", std::string(5000, 'l'), "third", "fourth", "fifth"};
+        FixedSizeTree<Sha256, 5, Sha256::value_type, bconcat::SegmentConcatenator, CountingInstrumentation> tree(d);
+        REQUIRE(tree.stats().concat_allocs == 0);
+        REQUIRE(tree.stats().hashed_bytes == (4 * 5 + 5 + 5000 + 5 + 6 + 5) + 6 * (4 + 2 * sizeof(Sha256::value_type)));
+    }
+
+}
+
+
+TEST_SUITE("Deep concatenator tests") {
+
+    struct Record {
+        uint32_t id;
+        std::string name;
+        std::vector<std::string> tags;
+
+        auto tie() const {
+            return std::tie(id, name, tags);
+        }
+    };
+
+
+    TEST_CASE("[deep] length-prefixed encoding") {
+        auto bytes = bconcat::DeepConcatenator::concat(std::vector<std::string>{"ab", "c"});
+        const std::vector<char> expected = {2, 0, 0, 0, 0, 0, 0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 'a', 'b', 1, 0, 0, 0, 0, 0, 0, 0, 'c'};
+        REQUIRE(bytes == expected);
+        REQUIRE(bytes.capacity() == bytes.size());
+        REQUIRE(bytes != bconcat::DeepConcatenator::concat(std::vector<std::string>{"a", "bc"}));
+
+        REQUIRE(bconcat::DeepConcatenator::concat(std::list<std::string>{"ab", "c"}) == expected);
+        REQUIRE(bconcat::DeepConcatenator::concat(std::pair{uint8_t{1}, std::string("x")}) == std::vector<char>{1, 1, 0, 0, 0, 0, 0, 0, 0, 'x'});
+    }
+
+
+    TEST_CASE("[deep] records as leaves") {
+        std::vector<Record> d = {{1, "kernel", {"boot", "signed"}}, {2, "rootfs", {}}, {3, "env", {"rw"}}};
+        const Record same = d[0];
+        FixedSizeTree<Sha256, 3, Sha256::value_type, bconcat::DeepConcatenator> tree(d);
+
+        REQUIRE(tree.verify(same));
+        REQUIRE(tree.verify_proof(d[2], tree.get_proof(d[2]).second));
+        REQUIRE(tree.leaf_hash(d[1]) == Sha256{}(bconcat::DeepConcatenator::concat(tree.leaf_salt, d[1])));
+        REQUIRE(bconcat::DeepConcatenator::size(d[0]) == 4 + (8 + 6) + 8 + (8 + 4) + (8 + 6));
+
+        d[1].tags.push_back("ro");
+        REQUIRE(!tree.verify(d[1]));
+    }
+
+}
+
+
+TEST_SUITE("Unified concatenator tests") {
+
+    TEST_CASE("[unified] contiguous and element-wise arguments") {
+        std::vector<uint8_t> raw = {1, 2, 250};
+        std::list<char> list = {'x', 'y'};
+        std::vector<uint16_t> wide = {3, 260};
+        auto bytes = bconcat::UnifiedConcatenator::concat(uint16_t{0x0102}, std::string("ab"), raw, list, wide, "z");
+
+        std::vector<char> expected(2);
+        memcpy(expected.data(), "\x02\x01", 2);
+        for(char c : {'a', 'b', '\x01', '\x02', '\xfa', 'x', 'y', '\x03', '\x04', 'z', '\0'})
+            expected.push_back(c);
+        REQUIRE(bytes == expected);
+        REQUIRE(bytes.capacity() == bytes.size());
+    }
+
+}
+
+
+TEST_SUITE("Scratch concatenator tests") {
+
+    TEST_CASE("[scratch] same roots as unified concatenator") {
+        std::vector<std::string> d = {"first", std::string(5000, 'l'), "third", "fourth", "fifth"};
+        FixedSizeTree<Sha256, 5> tree(d);
+        FixedSizeTree<Sha256, 5, Sha256::value_type, bconcat::ScratchConcatenator> scratch_tree(d);
+
+        REQUIRE(tree.root() == scratch_tree.root());
+        REQUIRE(scratch_tree.verify_proof(d[2], scratch_tree.get_proof(d[2]).second));
+    }
+
+
+    TEST_CASE("[scratch] buffer is reused") {
+        std::vector<std::string> d(64);
+        for(size_t i{};i < d.size();++i)
+            d[i] = std::string(i * 10, 'a' + i % 26);
+
+        FixedSizeTree<Sha256, 64, Sha256::value_type, bconcat::ScratchConcatenator, CountingInstrumentation> tree(d);
+        const auto root = tree.root();
+        REQUIRE(tree.stats().concat_allocs == 0);
+        REQUIRE(bconcat::ScratchConcatenator::capacity() >= 4 + 630);
+
+        const char* buf = bconcat::ScratchConcatenator::concat(0).data();
+        tree.build(d);
+        REQUIRE(tree.root() == root);
+        REQUIRE(bconcat::ScratchConcatenator::concat(0).data() == buf);
+
+        bconcat::ScratchConcatenator::release();
+        REQUIRE(bconcat::ScratchConcatenator::capacity() == 0);
+    }
+
+
+    TEST_CASE("[scratch] buffers are per thread") {
+        std::vector<std::string> d(1024);
+        for(size_t i{};i < d.size();++i)
+            d[i] = std::to_string(i * i);
+
+        FixedSizeTree<Sha256, 1024> tree(d);
+        FixedSizeTree<Sha256, 1024, Sha256::value_type, bconcat::ScratchConcatenator> scratch_tree{};
+        build_parallel(scratch_tree, d, ParallelOptions{.workers = 4, .subtree_leaves = 16});
+        REQUIRE(scratch_tree.root() == tree.root());
+    }
+
+}
+
+
+TEST_SUITE("Truncated hash tests") {
+
+    TEST_CASE("[truncated] smaller nodes") {
+        using Sha128 = Truncated<Sha256, 16>;
+        static_assert(sizeof(FixedSizeTree<Sha128, 1024>) * 2 == sizeof(FixedSizeTree<Sha256, 1024>));
+        static_assert(SegmentHasher<Sha128> && !SegmentHasher<Truncated<Fnv1a, 4>>);
+
+        auto full = Sha256{}(std::string("leaf"));
+        auto truncated = Sha128{}(std::string("leaf"));
+        REQUIRE(std::equal(truncated.begin(), truncated.end(), full.begin()));
+        REQUIRE(Sha128::State{}.update(std::string("leaf")).finish() == truncated);
+    }
+
+
+    TEST_CASE("[truncated] proofs are consistent") {
+        std::vector<std::string> d = {"first", "second", "third", "fourth", "fifth"};
+        FixedSizeTree<Truncated<Sha256, 8>, 5> tree(d);
+
+        for(auto&& x : d) {
+            auto [initial, proof] = tree.get_proof(x);
+            REQUIRE(tree.verify_proof(x, proof));
+
+            auto bytes = tree.get_compact_proof(x);
+            REQUIRE(bytes.size() == compact_proof::size<std::array<uint8_t, 8>>(tree.height(), true));
+            REQUIRE(tree.verify_proof(x, ProofView<std::array<uint8_t, 8>>(bytes.data(), bytes.size())));
+        }
+        REQUIRE_FALSE(tree.verify_proof(d[0], tree.get_proof(d[1]).second));
+
+        AppendOnlyTree<Truncated<Sha256, 16>> log{};
+        for(auto&& x : d)
+            log.append(x);
+        REQUIRE(log.verify_proof(3, d.size(), log.leaf_hash(d[3]), log.get_proof(3), log.root()));
+    }
+
+}
+
+
+TEST_SUITE("Struct-of-arrays layout tests") {
+
+    TEST_CASE("[soa] multi-buffer sha256") {
+        Sha256x8::Block block{};
+        for(size_t l{};l < Sha256x8::lanes;++l)
+            block[0][l] = 0x61626380 + (l << 8), block[15][l] = 24;   // "abc", "abd", ... padded
+
+        auto h = Sha256x8::init();
+        Sha256x8::compress(h, block);
+        for(size_t l{};l < Sha256x8::lanes;++l) {
+            auto digest = Sha256{}(std::string{'a', 'b', static_cast<char>('c' + l)});
+            for(size_t w{};w < 8;++w)
+                REQUIRE(h[w][l] == (uint32_t{digest[4 * w]} << 24 | uint32_t{digest[4 * w + 1]} << 16 | uint32_t{digest[4 * w + 2]} << 8 | digest[4 * w + 3]));
+        }
+    }
+
+
+    template<typename Hasher, uint64_t N>
+    void check_same_as_fixed_size() {
+        std::vector<std::string> d(N);
+        for(size_t i{};i < N;++i)
+            d[i] = std::to_string(i * 7919);
+
+        FixedSizeTree<Hasher, N> tree(d);
+        SoaTree<Hasher, N> soa(d);
+        REQUIRE(soa.root() == tree.root());
+        if constexpr (N > 1) {  // FixedSizeTree<_, 1>::get_proof returns the proof without the leaf
+            for(size_t i{};i < N;i += 1 + N / 7) {
+                auto proof = soa.get_proof(d[i]);
+                REQUIRE(proof == tree.get_proof(d[i]));
+                REQUIRE(soa.verify_proof(d[i], proof.second));
+                REQUIRE(tree.verify_proof(d[i], proof.second));
+            }
+            REQUIRE_FALSE(soa.verify((std::string)"missing"));
+        }
+    }
+
+
+    TEST_CASE("[soa] same tree as FixedSizeTree") {
+        check_same_as_fixed_size<Sha256, 1>();
+        check_same_as_fixed_size<Sha256, 2>();
+        check_same_as_fixed_size<Sha256, 5>();
+        check_same_as_fixed_size<Sha256, 17>();
+        check_same_as_fixed_size<Sha256, 64>();
+        check_same_as_fixed_size<Sha256, 1000>();
+        check_same_as_fixed_size<Fnv1a, 37>();
+        check_same_as_fixed_size<Hasher, 37>();
+    }
+
+}
+
+
+TEST_SUITE("NUMA build tests") {
+
+    TEST_CASE("[numa] topology") {
+        REQUIRE(NumaTopology::parse_cpulist("0-3,8,10-11\n") == std::vector<int>{0, 1, 2, 3, 8, 10, 11});
+        REQUIRE(NumaTopology::parse_cpulist("").empty());
+
+        auto detected = NumaTopology::detect();
+        REQUIRE(detected.size() >= 1);
+
+        auto simulated = NumaTopology::simulated(3);
+        REQUIRE(simulated.size() == 3);
+        for(auto& node : simulated.nodes)
+            REQUIRE_FALSE(node.empty());
+    }
+
+
+    TEST_CASE("[numa] pool threads run on the cpus of their node") {
+        NumaPools numa(NumaTopology::simulated(2), 1);
+        for(size_t n{};n < numa.nodes();++n) {
+            std::promise<int> cpu{};
+            numa.executor(n).execute([&] { cpu.set_value(sched_getcpu()); });
+            auto& cpus = numa.topology().nodes[n];
+            REQUIRE(std::find(cpus.begin(), cpus.end(), cpu.get_future().get()) != cpus.end());
+        }
+    }
+
+
+    TEST_CASE("[numa] same result as the serial build") {
+        std::vector<std::string> d(1000);
+        for(size_t i{};i < d.size();++i)
+            d[i] = std::to_string(i * 31);
+
+        NumaPools numa(NumaTopology::simulated(2), 2);
+        auto tree = std::make_unique<FixedSizeTree<Hasher, 1000>>();
+        auto serial = std::make_unique<FixedSizeTree<Hasher, 1000>>(d);
+
+        build_numa(*tree, d, numa, ParallelOptions{.workers = 2, .subtree_leaves = 16});
+        REQUIRE(std::equal(tree->data(), tree->data() + tree->size(), serial->data()));
+
+        build_numa(*tree, d, numa, ParallelOptions{.workers = 2, .subtree_leaves = 512});   // fewer blocks than nodes
+        REQUIRE(tree->root() == serial->root());
+
+        NumaPools three(NumaTopology::simulated(3), 1);
+        FixedSizeTree<Hasher, 256> small{};
+        build_numa(small, std::span(d).first(256), three, ParallelOptions{.workers = 1, .subtree_leaves = 8});
+        REQUIRE(small.root() == FixedSizeTree<Hasher, 256>(std::span(d).first(256)).root());
+
+        auto failing = std::views::iota(0, 256) | std::views::transform([](int i) {
+            if(i == 200)
+                throw std::runtime_error("unreadable leaf");
+            return std::to_string(i);
+        });
+        REQUIRE_THROWS_AS(build_numa(small, failing, three, ParallelOptions{.workers = 1, .subtree_leaves = 8}), std::runtime_error);
+    }
+
+}
+
+
+TEST_SUITE("Concurrent tree tests") {
+
+    TEST_CASE("[concurrent] same hashes as FixedSizeTree") {
+        std::vector<std::string> d(1001);
+        for(size_t i{};i < d.size();++i)
+            d[i] = std::to_string(i * 13);
+
+        FixedSizeTree<Hasher, 1001> tree(d);
+        ConcurrentTree<Hasher, 1001, Hasher::value_type, bconcat::UnifiedConcatenator, 64> ctree(d);
+        REQUIRE(ctree.root() == tree.root());
+
+        std::vector<std::pair<size_t, std::string>> changes = {{1000, "last"}, {3, "a"}, {4, "b"}, {3, "c"}, {5000, "skipped"}};
+        for(auto& [idx, x] : changes)
+            tree.update(idx, x);
+        REQUIRE(ctree.update(changes) == 4);
+        REQUIRE(ctree.root() == tree.root());
+
+        REQUIRE(ctree.update(500, std::string("single")));
+        tree.update(500, std::string("single"));
+        auto snap = ctree.snapshot();
+        REQUIRE(snap.root() == tree.root());
+        REQUIRE(snap.get_proof(500) == tree.get_proof(std::string("single")));
+        REQUIRE(ctree.verify_proof(std::string("single"), snap.get_proof(500).second));
+
+        REQUIRE(ctree.verify(std::string("single")));
+        REQUIRE(ctree.has(std::string("last")));
+        REQUIRE_FALSE(ctree.verify(d[500]));
+        REQUIRE(ctree.height() == tree.height());
+        REQUIRE(ctree.size() == tree.size());
+    }
+
+
+    TEST_CASE("[concurrent] snapshots are immutable and keep their version") {
+        std::vector<std::string> d = {"first", "second", "third", "fourth", "fifth"};
+        ConcurrentTree<Hasher, 5, Hasher::value_type, bconcat::UnifiedConcatenator, 4> tree(d);
+        const auto old_root = tree.root();
+
+        {
+            auto old = tree.snapshot();
+            tree.update(1, std::string("changed"));
+            tree.update(2, std::string("changed too"));
+            REQUIRE(old.root() == old_root);
+            REQUIRE(tree.verify_proof(d[1], old.get_proof(1).second));
+            REQUIRE(tree.root() != old_root);
+            REQUIRE(tree.retired() == 2);   // the snapshot may still read them
+        }
+
+        tree.reclaim();
+        REQUIRE(tree.retired() == 0);
+        REQUIRE(tree.snapshot().get_proof(5).first == Hasher::value_type{});
+    }
+
+
+    TEST_CASE("[concurrent] readers during updates") {
+        constexpr size_t N = 256;
+        std::vector<std::string> d(N);
+        for(size_t i{};i < N;++i)
+            d[i] = std::to_string(i);
+
+        ConcurrentTree<Hasher, N, Hasher::value_type, bconcat::UnifiedConcatenator, 16, 4> tree(d);
+        std::atomic<bool> stop{};
+        std::atomic<size_t> failures{}, reads{};
+
+        std::vector<std::thread> readers{};
+        for(size_t r{};r < 6;++r)   // more readers than slots
+            readers.emplace_back([&, r] {
+                for(size_t i = r;!stop.load();i = (i + 7) % N) {
+                    auto snap = tree.snapshot();
+                    auto proof = snap.get_proof(i);
+                    Hasher::value_type curr = proof.first;
+                    for(size_t k{};k + 1 < proof.second.size();++k)
+                        curr = proof.second[k].second? tree.node_hash(proof.second[k].first, curr) : tree.node_hash(curr, proof.second[k].first);
+                    failures += curr != snap.root();
+                    ++reads;
+                }
+            });
+
+        for(size_t u{};u < 200;++u) {
+            std::vector<std::pair<size_t, std::string>> changes = {{u % N, std::to_string(u)}, {(u * 31) % N, "x"}};
+            tree.update(changes);
+        }
+        while(reads.load() < 100)
+            std::this_thread::yield();
+        stop = true;
+        for(auto& t : readers)
+            t.join();
+
+        REQUIRE(failures.load() == 0);
+        tree.reclaim();
+        REQUIRE(tree.retired() == 0);
+    }
+
+}
+
+
+TEST_SUITE("Partitioned update tests") {
+
+    TEST_CASE("[partitioned] writers of different subtrees") {
+        constexpr size_t N = 1000;
+        std::vector<std::string> d(N);
+        for(size_t i{};i < N;++i)
+            d[i] = std::to_string(i);
+
+        auto tree = std::make_unique<FixedSizeTree<Hasher, N>>(d);
+        auto batch = tree->partitioned_update(64);
+        REQUIRE(batch.partitions() == 16);
+        REQUIRE(batch.partition_of(999) == 15);
+
+        std::vector<std::thread> writers{};
+        for(size_t t{};t < 4;++t)
+            writers.emplace_back([&, t] {
+                for(size_t p = t;p < batch.partitions();p += 4)    // every thread owns every 4th partition
+                    for(size_t i = p * 64;i < std::min((p + 1) * 64, N);i += 3 + p % 5)
+                        batch.update(i, d[i] += "*");
+            });
+        for(auto& w : writers)
+            w.join();
+
+        REQUIRE_FALSE(batch.update(N, std::string("out of range")));
+        REQUIRE(batch.commit() == 8 + 4 + 2 + 1);
+        REQUIRE(tree->root() == FixedSizeTree<Hasher, N>(d).root());
+        REQUIRE(batch.commit() == 0);
+    }
+
+
+    TEST_CASE("[partitioned] odd layers and partition sizes") {
+        std::vector<std::string> d = {"a", "b", "c", "d", "e", "f", "g"};
+        for(size_t sub : {1, 2, 4, 8, 100}) {
+            FixedSizeTree<Hasher, 7> tree(d);
+            auto batch = tree.partitioned_update(sub);
+            auto changed = d;
+            changed[6] = "last", changed[1] = "second";
+            batch.update(6, changed[6]);
+            batch.update(1, changed[1]);
+            batch.commit();
+            REQUIRE(tree.root() == FixedSizeTree<Hasher, 7>(changed).root());
+            REQUIRE(tree.verify_proof(changed[6], tree.get_proof(changed[6]).second));
+        }
+    }
+
+}
+
+
+TEST_SUITE("Hash cache tests") {
+
+    TEST_CASE("[cache] rebuild hashes only the changed paths") {
+        constexpr size_t N = 1000;
+        std::vector<std::string> d(N);
+        for(size_t i{};i < N;++i)
+            d[i] = std::to_string(i);
+
+        using Tree = FixedSizeTree<Hasher, N, Hasher::value_type, bconcat::UnifiedConcatenator, CountingInstrumentation>;
+        HashCache<Hasher::value_type> cache(1 << 20);
+        auto tree = std::make_unique<Tree>();
+
+        tree->build(d, cache);
+        auto first = tree->stats();
+        REQUIRE(tree->root() == FixedSizeTree<Hasher, N>(d).root());
+        REQUIRE(first.hashes() == cache.misses());
+        REQUIRE(first.hashes() + cache.hits() == Tree(d).stats().hashes());   // equal inputs are hashed once
+
+        tree->build(d, cache);
+        REQUIRE((tree->stats() - first).hashes() == 0);
+        REQUIRE(cache.misses() == first.hashes());
+
+        d[123] = "changed", d[999] = "last";
+        auto before = tree->stats();
+        tree->build(d, cache);
+        REQUIRE((tree->stats() - before).leaf_hashes == 2);
+        REQUIRE((tree->stats() - before).node_hashes <= 2 * Tree::height(N));
+        REQUIRE(tree->root() == FixedSizeTree<Hasher, N>(d).root());
+    }
+
+
+    TEST_CASE("[cache] lru eviction within the budget") {
+        using Cache = HashCache<Hasher::value_type>;
+        constexpr size_t entry = sizeof(Cache::Key) + sizeof(Hasher::value_type) + Cache::entry_overhead;
+        Cache cache(2 * entry);
+        Hasher::value_type a{'a'}, b{'b'}, c{'c'};
+        auto key = [](std::string_view s) { return Cache::key(s); };
+
+        cache.insert(key("a"), a);
+        cache.insert(key("b"), b);
+        REQUIRE(cache.find(key("a")) == a);   // "b" is the least recently used now
+        cache.insert(key("c"), c);
+        REQUIRE(cache.size() == 2);
+        REQUIRE(cache.bytes() == 2 * entry);
+        REQUIRE(cache.evictions() == 1);
+        REQUIRE_FALSE(cache.find(key("b")));
+        REQUIRE(cache.find(key("a")) == a);
+        REQUIRE(cache.find(key("c")) == c);
+
+        cache.insert(key(std::string(1 << 20, 'x')), a);   // the key size does not depend on the input
+        REQUIRE(cache.size() == 2);
+        REQUIRE(cache.bytes() == 2 * entry);
+        REQUIRE(cache.find(key(std::string(1 << 20, 'x'))) == a);
+
+        auto split = Cache::key(bconcat::SegmentConcatenator::concat(std::string_view("abc"), std::string_view("defghijklm")));
+        REQUIRE(split == key("abcdefghijklm"));
+        REQUIRE(split.check == key("abcdefghijklm").check);
+
+        auto forged = key("c");
+        forged.check ^= 1;   // same fingerprint and size, other input
+        REQUIRE_FALSE(cache.find(forged));
+        REQUIRE(cache.find(key("c")) == c);
+
+        cache.set_budget(entry);
+        REQUIRE(cache.size() == 1);
+        REQUIRE(cache.find(key("c")) == c);
+
+        cache.clear();
+        REQUIRE(cache.size() == 0);
+        REQUIRE(cache.bytes() == 0);
+    }
+
+
+    TEST_CASE("[cache] small budget and shared cache keep the roots correct") {
+        std::vector<std::string> d = {"first", "second", "third", "fourth", "fifth", "sixth", "seventh"};
+        HashCache<Hasher::value_type> cache(5 * HashCache<Hasher::value_type>::entry_overhead);
+        FixedSizeTree<Hasher, 7> tree{};
+        for(size_t i{};i < d.size();++i) {
+            d[i] += "*";
+            REQUIRE(tree.build(d, cache).root() == FixedSizeTree<Hasher, 7>(d).root());
+            REQUIRE(cache.bytes() <= cache.budget());
+        }
+        REQUIRE(cache.evictions() > 0);
+
+        FixedSizeTree<Hasher, 1> single{};
+        REQUIRE(single.build(std::vector<std::string>{"one"}, cache).root() == FixedSizeTree<Hasher, 1>(std::vector<std::string>{"one"}).root());
+
+        FixedSizeTree<Sha256, 7, Sha256::value_type, bconcat::SegmentConcatenator> seg{};
+        HashCache<Sha256::value_type> sha_cache(1 << 16);
+        seg.build(d, sha_cache);
+        REQUIRE(seg.build(d, sha_cache).root() == FixedSizeTree<Sha256, 7>(d).root());
+        REQUIRE(sha_cache.hits() == 7 + 4 + 2 + 1);
+    }
+
 }};